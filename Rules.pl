@@ -28,20 +28,36 @@ $V{LIBS} = "$V{LIBS} $save";
 
 # Compile stuff
 my @SOURCE = qw(
+   batch.c
+   batch.h
    commands.c
    commands.h
    config.c
    config.h
+   daemon.c
+   daemon.h
+   events.c
+   events.h
    language.c
    language.h
+   league.c
+   league.h
+   log.c
+   log.h
    message.c
    message.h
+   metrics.c
+   metrics.h
    sendconf.c
    sendconf.h
    score.c
    score.h
+   scoreboard.c
+   scoreboard.h
    state.c
    state.h
+   stats.c
+   stats.h
    util.c
    util.h
    utildata.c
@@ -0,0 +1,273 @@
+/**
+  *  \file batch.c
+  *  \brief Agave Tequilana - Batch Processing
+  *
+  *  The PDK is not reentrant, so parallelism is achieved by forking.
+  *  The parent process never initializes the PDK; each child processes one game.
+  */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "batch.h"
+
+static const char*const OUTPUT_FILE_NAME = "cactus.out";
+
+/** Game status.
+    @private */
+enum GameStatus {
+    Game_Pending,
+    Game_Running,
+    Game_Done,
+    Game_Lost                           ///< Process was running but could not be waited for.
+};
+
+/** A game in the batch.
+    @private */
+struct Game {
+    char* Directory;                    ///< Game directory.
+    unsigned long long Size;            ///< Total size of files in game directory.
+    pid_t Pid;                          ///< Process Id, if running.
+    enum GameStatus Status;             ///< Status.
+    int ExitStatus;                     ///< Exit status (as returned by waitpid), if done.
+    double StartTime;                   ///< Start time, seconds.
+    double Duration;                    ///< Run time, seconds.
+};
+
+/** List of games.
+    @private */
+struct GameList {
+    struct Game* Games;
+    size_t NumGames;
+    size_t Capacity;
+};
+
+/* Get monotonic time in seconds. */
+static double GetTime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + ts.tv_nsec / 1.0e9;
+}
+
+/* Determine size of a game: total size of regular files in its directory. */
+static unsigned long long GetGameSize(const char* dirName)
+{
+    unsigned long long result = 0;
+    DIR* dir = opendir(dirName);
+    if (dir != 0) {
+        struct dirent* ent;
+        while ((ent = readdir(dir)) != 0) {
+            char* name = MemAlloc(strlen(dirName) + strlen(ent->d_name) + 2);
+            struct stat st;
+            sprintf(name, "%s/%s", dirName, ent->d_name);
+            if (stat(name, &st) == 0 && S_ISREG(st.st_mode)) {
+                result += (unsigned long long) st.st_size;
+            }
+            MemFree(name);
+        }
+        closedir(dir);
+    }
+    return result;
+}
+
+/* Read list file. */
+static Boolean ReadGameList(const char* fileName, struct GameList* pList)
+{
+    FILE* fp = fopen(fileName, "r");
+    if (fp == 0) {
+        fprintf(stderr, "%s: unable to open file\n", fileName);
+        return False;
+    }
+
+    char line[1024];
+    while (fgets(line, sizeof(line), fp) != 0) {
+        line[strcspn(line, "\r\n")] = '\0';
+        const char* p = line + strspn(line, " \t");
+        if (*p == '\0' || *p == '#') {
+            continue;
+        }
+
+        if (pList->NumGames >= pList->Capacity) {
+            pList->Capacity = 2*pList->Capacity + 16;
+            pList->Games = MemRealloc(pList->Games, pList->Capacity * sizeof(struct Game));
+        }
+
+        struct Game* g = &pList->Games[pList->NumGames++];
+        g->Directory = MemAlloc(strlen(p) + 1);
+        strcpy(g->Directory, p);
+        g->Size = GetGameSize(p);
+        g->Pid = 0;
+        g->Status = Game_Pending;
+        g->ExitStatus = 0;
+        g->StartTime = 0;
+        g->Duration = 0;
+    }
+    fclose(fp);
+    return True;
+}
+
+/* Sort games, largest first. */
+static int CompareGames(const void* a, const void* b)
+{
+    const struct Game* ga = a;
+    const struct Game* gb = b;
+    if (ga->Size != gb->Size) {
+        return ga->Size > gb->Size ? -1 : 1;
+    }
+    return strcmp(ga->Directory, gb->Directory);
+}
+
+/* Start a game in a child process.
+   Returns false if the process cannot be created. */
+static Boolean StartGame(struct Game* g, void func(void* pData), void* pData)
+{
+    fflush(stdout);
+    fflush(stderr);
+
+    g->StartTime = GetTime();
+    pid_t pid = fork();
+    if (pid < 0) {
+        return False;
+    }
+    if (pid == 0) {
+        // Child
+        char* name = MemAlloc(strlen(g->Directory) + strlen(OUTPUT_FILE_NAME) + 2);
+        sprintf(name, "%s/%s", g->Directory, OUTPUT_FILE_NAME);
+        if (freopen(name, "w", stdout) != 0) {
+            dup2(fileno(stdout), fileno(stderr));
+        }
+        MemFree(name);
+
+        gGameDirectory = g->Directory;
+        func(pData);
+        exit(0);
+    }
+
+    g->Pid = pid;
+    g->Status = Game_Running;
+    return True;
+}
+
+/* Describe a game's result. */
+static void FormatResult(const struct Game* g, char* buffer, size_t size)
+{
+    if (g->Status == Game_Lost) {
+        snprintf(buffer, size, "lost");
+    } else if (g->Status != Game_Done) {
+        snprintf(buffer, size, "not run");
+    } else if (WIFEXITED(g->ExitStatus)) {
+        if (WEXITSTATUS(g->ExitStatus) == 0) {
+            snprintf(buffer, size, "ok");
+        } else {
+            snprintf(buffer, size, "exit %d", WEXITSTATUS(g->ExitStatus));
+        }
+    } else if (WIFSIGNALED(g->ExitStatus)) {
+        snprintf(buffer, size, "signal %d", WTERMSIG(g->ExitStatus));
+    } else {
+        snprintf(buffer, size, "failed");
+    }
+}
+
+static Boolean IsSuccess(const struct Game* g)
+{
+    return g->Status == Game_Done && WIFEXITED(g->ExitStatus) && WEXITSTATUS(g->ExitStatus) == 0;
+}
+
+
+/*
+ *  Public Interface
+ */
+
+Boolean Batch_Run(const char* listFileName, int numJobs, void func(void* pData), void* pData)
+{
+    struct GameList list = { 0, 0, 0 };
+    if (!ReadGameList(listFileName, &list)) {
+        return False;
+    }
+    if (list.NumGames != 0) {
+        qsort(list.Games, list.NumGames, sizeof(struct Game), CompareGames);
+    }
+    if (numJobs < 1) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        numJobs = (n > 0 ? (int) n : 1);
+    }
+
+    // Run games. Whenever a process finishes, the next pending game is started.
+    const double startTime = GetTime();
+    size_t next = 0;
+    int numRunning = 0;
+    while (next < list.NumGames || numRunning > 0) {
+        while (numRunning < numJobs && next < list.NumGames) {
+            struct Game* g = &list.Games[next++];
+            if (StartGame(g, func, pData)) {
+                ++numRunning;
+            } else {
+                fprintf(stderr, "%s: unable to start process\n", g->Directory);
+            }
+        }
+
+        if (numRunning > 0) {
+            int status;
+            pid_t pid = wait(&status);
+            if (pid < 0) {
+                if (errno == ECHILD) {
+                    // No more children although we think some are running; count them as failed.
+                    fprintf(stderr, "Lost track of %d child process(es)\n", numRunning);
+                    for (size_t i = 0; i < list.NumGames; ++i) {
+                        if (list.Games[i].Status == Game_Running) {
+                            list.Games[i].Status = Game_Lost;
+                        }
+                    }
+                    numRunning = 0;
+                } else if (errno != EINTR) {
+                    fprintf(stderr, "Unable to wait for child process: %s\n", strerror(errno));
+                }
+                continue;
+            }
+            for (size_t i = 0; i < list.NumGames; ++i) {
+                struct Game* g = &list.Games[i];
+                if (g->Status == Game_Running && g->Pid == pid) {
+                    g->Status = Game_Done;
+                    g->ExitStatus = status;
+                    g->Duration = GetTime() - g->StartTime;
+                    --numRunning;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Summary
+    size_t numFailed = 0;
+    printf("Result       Time  Game\n"
+           "--------  -------  ----------------\n");
+    for (size_t i = 0; i < list.NumGames; ++i) {
+        const struct Game* g = &list.Games[i];
+        char result[30];
+        FormatResult(g, result, sizeof(result));
+        printf("%-8s  %6.1fs  %s\n", result, g->Duration, g->Directory);
+        if (!IsSuccess(g)) {
+            ++numFailed;
+        }
+    }
+    printf("\n%d game(s), %d failed, %d process(es), %.1fs total\n",
+           (int) list.NumGames, (int) numFailed, numJobs, GetTime() - startTime);
+
+    for (size_t i = 0; i < list.NumGames; ++i) {
+        MemFree(list.Games[i].Directory);
+    }
+    if (list.Games != 0) {
+        MemFree(list.Games);
+    }
+    return numFailed == 0;
+}
@@ -0,0 +1,28 @@
+/**
+  *  \file batch.h
+  *  \brief Agave Tequilana - Batch Processing
+  */
+#ifndef BATCH_H_INCLUDED
+#define BATCH_H_INCLUDED
+
+#include <phostpdk.h>
+
+/** Process multiple games in parallel.
+    Reads a list of game directories (one per line; empty lines and lines starting with '#' are ignored),
+    and processes each in a separate process, using at most @c numJobs processes at a time
+    (default: number of processors).
+    Games are started largest first (by total size of the files in the game directory),
+    each further game is handed to the next process that becomes free.
+
+    Each process's output is captured in file `cactus.out` in the game directory.
+    When all games are processed, a summary is printed to stdout.
+
+    @param [in] listFileName  Name of list file
+    @param [in] numJobs       Maximum number of parallel processes; 0 for default
+    @param [in] func          Function to process a game; called in a child process with gGameDirectory set.
+                              The process's exit status is the game's status.
+    @param [in] pData         Opaque parameter for func
+    @return true if all games succeeded */
+Boolean Batch_Run(const char* listFileName, int numJobs, void func(void* pData), void* pData);
+
+#endif
@@ -3,82 +3,581 @@
   *  \brief Agave Tequilana - Command Handling
   */
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <strings.h>
 #include <string.h>
 #include <ctype.h>
 #include "commands.h"
+#include "events.h"
+#include "log.h"
 #include "message.h"
+#include "score.h"
+#include "stats.h"
 #include "util.h"
 
 static const char MSG_TERMINATOR = 26;
 static const char MSG_OFFSET = 13;
 
-/** @private */
+/** Command verb, in order of application.
+    Votes go first so they are not crowded out by CommandLimit.
+    @private */
+enum Verb {
+    Verb_Vote,
+    Verb_Build
+};
+
+/** Command source, in increasing precedence.
+    @private */
+enum Source {
+    Source_Message,
+    Source_Command
+};
+
+/** Parsed command.
+    @private */
+struct Command {
+    Uns32 Sequence;                     ///< Order of appearance, for sorting.
+    Uns16 Planet;                       ///< Planet Id (Verb_Build).
+    Uns8 Player;                        ///< Player who gave the command.
+    Uns8 Verb;                          ///< Verb (enum Verb).
+    Uns8 Source;                        ///< Source (enum Source).
+    Uns8 Value;                         ///< Vote (Verb_Vote).
+};
+
+/** Command table.
+    Collects commands from all sources before they are applied.
+    @private */
+struct CommandTable {
+    struct Command* Commands;
+    size_t NumCommands;
+    size_t Capacity;
+    Uns32 NumApplied[RACE_NR+1];        ///< Number of commands applied, per player.
+    struct CommandReport* pReport;      ///< Error report.
+};
+
+/** Command processing context.
+    Parsed commands are either applied to pTable, or, when ingesting, written to IngestFiles.
+    @private */
 struct CommandInfo {
-    struct State* pState;
+    struct CommandTable* pTable;
     const struct Config* pConfig;
+    const struct State* pState;
+    enum Source Source;
+    Boolean Ingest;
+    FILE* IngestFiles[RACE_NR+1];
+    Uns16 SkipMessages;                 ///< Players whose messages have already been ingested, bitfield.
+};
+
+
+/*
+ *  Command Table
+ */
+
+static void CommandTable_Init(struct CommandTable* pTable, struct CommandReport* pReport)
+{
+    pTable->Commands = 0;
+    pTable->NumCommands = 0;
+    pTable->Capacity = 0;
+    memset(pTable->NumApplied, 0, sizeof(pTable->NumApplied));
+    pTable->pReport = pReport;
+}
+
+static void CommandTable_Free(struct CommandTable* pTable)
+{
+    if (pTable->Commands != 0) {
+        MemFree(pTable->Commands);
+    }
+    CommandTable_Init(pTable, pTable->pReport);
+}
+
+static void CommandTable_Add(struct CommandTable* pTable, Uns16 player, enum Verb verb, Uns16 planet, Uns8 value, enum Source source)
+{
+    if (pTable->NumCommands >= pTable->Capacity) {
+        pTable->Capacity = 2*pTable->Capacity + 100;
+        pTable->Commands = MemRealloc(pTable->Commands, pTable->Capacity * sizeof(struct Command));
+    }
+
+    struct Command* p = &pTable->Commands[pTable->NumCommands];
+    p->Sequence = (Uns32) pTable->NumCommands;
+    p->Planet = planet;
+    p->Player = (Uns8) player;
+    p->Verb = (Uns8) verb;
+    p->Source = (Uns8) source;
+    p->Value = value;
+    ++pTable->NumCommands;
+}
+
+/* Compare two commands.
+   Commands that affect the same thing (player, verb, planet) are adjacent,
+   ordered by precedence (source, then sequence). */
+static int CompareCommands(const void* a, const void* b)
+{
+    const struct Command* ca = a;
+    const struct Command* cb = b;
+    if (ca->Player != cb->Player) {
+        return ca->Player < cb->Player ? -1 : 1;
+    } else if (ca->Verb != cb->Verb) {
+        return ca->Verb < cb->Verb ? -1 : 1;
+    } else if (ca->Planet != cb->Planet) {
+        return ca->Planet < cb->Planet ? -1 : 1;
+    } else if (ca->Source != cb->Source) {
+        return ca->Source < cb->Source ? -1 : 1;
+    } else {
+        return ca->Sequence < cb->Sequence ? -1 : 1;
+    }
+}
+
+/* Sort command table and remove duplicates.
+   Of multiple commands affecting the same thing, the one with highest precedence remains:
+   a command wins over a message, and a later one wins over an earlier one from the same source. */
+static void CommandTable_Normalize(struct CommandTable* pTable)
+{
+    if (pTable->NumCommands == 0) {
+        return;
+    }
+
+    qsort(pTable->Commands, pTable->NumCommands, sizeof(struct Command), CompareCommands);
+
+    size_t out = 0;
+    for (size_t in = 0; in < pTable->NumCommands; ++in) {
+        const struct Command* p = &pTable->Commands[in];
+        const struct Command* next = p+1;
+        if (in+1 == pTable->NumCommands
+            || p->Player != next->Player
+            || p->Verb != next->Verb
+            || p->Planet != next->Planet)
+        {
+            pTable->Commands[out++] = *p;
+        }
+    }
+    pTable->NumCommands = out;
+}
+
+/* Apply commands to state.
+   Commands are verified against pState (=previous turn's state).
+   Each player's commands are applied up to CommandLimit. */
+static void CommandTable_Apply(struct CommandTable* pTable, struct State* pState, const struct Config* pConfig)
+{
+    for (size_t i = 0; i < pTable->NumCommands; ++i) {
+        const struct Command* p = &pTable->Commands[i];
+        if (pConfig->CommandLimit > 0 && pTable->NumApplied[p->Player] >= (Uns32) pConfig->CommandLimit) {
+            ++pTable->pReport->NumDropped[p->Player];
+            continue;
+        }
+        ++pTable->NumApplied[p->Player];
+        Stats_Add(Stat_Commands, 1);
+
+        switch ((enum Verb) p->Verb) {
+         case Verb_Build:
+            if (p->Player == State_PlanetOwner(pState, p->Planet)) {
+                State_SetBuildRequest(pState, p->Planet, True);
+            } else {
+                LOG_INFO("\t(-) rejected build from %d: planet %d (not owned)", (int) p->Player, (int) p->Planet);
+                Stats_Add(Stat_FailNotOwned, 1);
+                Events_Add(Event_BuildFailed, (RaceType_Def) p->Player, p->Planet, Build_FailNotOwned);
+                if (CommandReport_AddError(pTable->pReport, p->Player, pConfig)) {
+                    Message_CactusFailed_NotOwned(p->Player, p->Planet);
+                }
+            }
+            break;
+
+         case Verb_Vote:
+            State_SetVote(pState, p->Player, p->Value != 0);
+            break;
+        }
+    }
+}
+
+
+/*
+ *  Command Parsing
+ */
+
+/** Result of an argument parser.
+    @private */
+enum ParseResult {
+    Parse_Ok,                           ///< Arguments valid.
+    Parse_Error,                        ///< Syntax error; report to player.
+    Parse_Ignore                        ///< Not a command after all; ignore silently.
 };
 
-static void ProcessBuildCommand(Uns16 pRace, const char* pArgs, const char* pWholeLine, const struct CommandInfo*const pInfo)
+/** Number of words in a PlanetSet.
+    @private */
+#define PLANET_SET_WORDS ((PLANET_NR + 32) / 32)
+
+/** Set of planets, bitfield indexed by planet Id.
+    @private */
+struct PlanetSet {
+    Uns32 Bits[PLANET_SET_WORDS];
+};
+
+/** Parsed command arguments.
+    @private */
+struct CommandArgs {
+    struct PlanetSet Planets;           ///< Planets (Verb_Build).
+    Boolean AllEligible;                ///< True for "all-eligible" (Verb_Build).
+    Uns8 Value;                         ///< Vote (Verb_Vote).
+};
+
+static void PlanetSet_Add(struct PlanetSet* pSet, Uns16 planetId)
 {
+    pSet->Bits[planetId / 32] |= (Uns32) 1 << (planetId % 32);
+}
+
+static Boolean PlanetSet_Contains(const struct PlanetSet* pSet, Uns16 planetId)
+{
+    return (pSet->Bits[planetId / 32] & ((Uns32) 1 << (planetId % 32))) != 0;
+}
+
+/* Parse a planet Id, advancing the pointer. */
+static Boolean ParsePlanetId(const char** pp, Uns16* pPlanet)
+{
+    const char* p = *pp + strspn(*pp, " \t");
+    if (!isdigit((unsigned char) *p)) {
+        return False;
+    }
+
     char* rem;
-    long parsed = strtol(pArgs, &rem, 10);
-    if (rem[strspn(rem, " \t")] == '\0' && parsed > 0 && parsed <= PLANET_NR) {
-        const Uns16 planetId = (Uns16) parsed;
-        if (pRace == State_PlanetOwner(pInfo->pState, planetId)) {
-            State_SetBuildRequest(pInfo->pState, planetId, True);
-        } else {
-            Info("\t(-) rejected command from %d: '%s' (not owned)", (int) pRace, pWholeLine);
-            Message_CactusFailed_NotOwned(pRace, planetId);
+    long parsed = strtol(p, &rem, 10);
+    if (parsed <= 0 || parsed > PLANET_NR) {
+        return False;
+    }
+    *pPlanet = (Uns16) parsed;
+    *pp = rem + strspn(rem, " \t");
+    return True;
+}
+
+/* Argument parser: planets.
+   Accepts a list of planet Ids and ranges ("12-40,77,101"), or "all-eligible". */
+static enum ParseResult ParsePlanetArgs(const char* pArgs, struct CommandArgs* pResult)
+{
+    const char* rest = StrStartsWith(pArgs, "all-eligible");
+    if (rest != 0 && rest[strspn(rest, " \t")] == '\0') {
+        pResult->AllEligible = True;
+        return Parse_Ok;
+    }
+
+    while (1) {
+        Uns16 first, last;
+        if (!ParsePlanetId(&pArgs, &first)) {
+            return Parse_Error;
+        }
+        last = first;
+        if (*pArgs == '-') {
+            ++pArgs;
+            if (!ParsePlanetId(&pArgs, &last) || last < first) {
+                return Parse_Error;
+            }
+        }
+        for (Uns16 i = first; i <= last; ++i) {
+            PlanetSet_Add(&pResult->Planets, i);
+        }
+        if (*pArgs != ',') {
+            break;
         }
+        ++pArgs;
+    }
+    return *pArgs == '\0' ? Parse_Ok : Parse_Error;
+}
+
+/* Argument parser: object reference produced by VPA, "Planet NNN". */
+static enum ParseResult ParseObjectArgs(const char* pArgs, struct CommandArgs* pResult)
+{
+    const char* rest = StrStartsWith(pArgs, "Planet ");
+    Uns16 planetId;
+    if (rest == 0) {
+        return Parse_Ignore;
+    } else if (ParsePlanetId(&rest, &planetId) && *rest == '\0') {
+        PlanetSet_Add(&pResult->Planets, planetId);
+        return Parse_Ok;
     } else {
-        Info("\t(-) rejected command from %d: '%s' (syntax error)", (int) pRace, pWholeLine);
-        Message_CommandSyntaxError(pRace, pWholeLine);
+        return Parse_Error;
     }
 }
 
-static void ProcessVoteCommand(Uns16 pRace, const char* pArgs, const char* pWholeLine, const struct CommandInfo*const pInfo)
+/* Argument parser: boolean. */
+static enum ParseResult ParseBooleanArgs(const char* pArgs, struct CommandArgs* pResult)
 {
     if (strcasecmp(pArgs, "yes") == 0 || strcasecmp(pArgs, "true") == 0) {
-        State_SetVote(pInfo->pState, pRace, True);
+        pResult->Value = 1;
+        return Parse_Ok;
     } else if (strcasecmp(pArgs, "no") == 0 || strcasecmp(pArgs, "false") == 0) {
-        State_SetVote(pInfo->pState, pRace, False);
+        pResult->Value = 0;
+        return Parse_Ok;
     } else {
-        Info("\t(-) rejected command from %d: '%s' (syntax error)", (int) pRace, pWholeLine);
+        return Parse_Error;
+    }
+}
+
+/** Command definition.
+    @private */
+struct CommandDefinition {
+    const char* Name;                   ///< Command verb as given by player.
+    enum Verb Verb;                     ///< Verb to produce.
+    enum ParseResult (*ParseArgs)(const char* pArgs, struct CommandArgs* pResult);  ///< Argument parser.
+    Uns8 Sources;                       ///< Accepted sources, bitfield of (1 << enum Source).
+};
+
+/** Accept command from any source.
+    @private */
+#define ANY_SOURCE ((1 << Source_Command) | (1 << Source_Message))
+
+/* All commands.
+   Add new commands here; the hash table adapts automatically. */
+static const struct CommandDefinition COMMAND_DEFINITIONS[] = {
+    { "build",   Verb_Build, ParsePlanetArgs,  ANY_SOURCE },
+    { "defhw",   Verb_Build, ParsePlanetArgs,  ANY_SOURCE },
+    { "OBJECT:", Verb_Build, ParseObjectArgs,  1 << Source_Message },
+    { "vote",    Verb_Vote,  ParseBooleanArgs, ANY_SOURCE },
+};
+
+/** Size of command hash table; power of 2, and comfortably larger than number of commands.
+    @private */
+#define COMMAND_HASH_SIZE 32
+
+/* Command hash table: index into COMMAND_DEFINITIONS plus 1, 0 if unused. */
+static Uns8 gCommandHash[COMMAND_HASH_SIZE];
+static Uns32 gCommandHashSeed;
+static Boolean gCommandHashReady;
+
+/* Case-insensitive hash function. */
+static Uns32 HashCommand(const char* name, size_t length, Uns32 seed)
+{
+    return HashBytesNoCase(HASH_INIT ^ seed, name, length) & (COMMAND_HASH_SIZE-1);
+}
+
+/* Build perfect hash table.
+   Tries seeds until one produces no collisions. This happens once per run. */
+static void InitCommandHash(void)
+{
+    const size_t numCommands = sizeof(COMMAND_DEFINITIONS)/sizeof(COMMAND_DEFINITIONS[0]);
+    for (Uns32 seed = 0; seed < 10000; ++seed) {
+        Boolean ok = True;
+        memset(gCommandHash, 0, sizeof(gCommandHash));
+        for (size_t i = 0; i < numCommands && ok; ++i) {
+            const char* name = COMMAND_DEFINITIONS[i].Name;
+            Uns8* slot = &gCommandHash[HashCommand(name, strlen(name), seed)];
+            if (*slot == 0) {
+                *slot = (Uns8) (i+1);
+            } else {
+                ok = False;
+            }
+        }
+        if (ok) {
+            gCommandHashSeed = seed;
+            gCommandHashReady = True;
+            return;
+        }
+    }
+    Log_Flush();
+    ErrorExit("Internal error: unable to build command table");
+}
+
+/* Look up a command by name. Returns null if not found. */
+static const struct CommandDefinition* FindCommand(const char* name, size_t length)
+{
+    if (!gCommandHashReady) {
+        InitCommandHash();
+    }
+
+    Uns8 index = gCommandHash[HashCommand(name, length, gCommandHashSeed)];
+    if (index != 0) {
+        const struct CommandDefinition* def = &COMMAND_DEFINITIONS[index-1];
+        if (strlen(def->Name) == length && strncasecmp(def->Name, name, length) == 0) {
+            return def;
+        }
+    }
+    return 0;
+}
+
+/* Add build commands for a set of planets.
+   A command for a single planet is added as is and validated when it is applied.
+   Bulk commands (lists, ranges, all-eligible) are restricted to the player's planets
+   that can currently receive a cactus.
+   Planets skipped from a list or range are counted for the summary message;
+   all-eligible skips other planets silently. */
+static void AddBuildCommands(Uns16 pRace, struct CommandArgs* pArgs, const struct CommandInfo*const pInfo)
+{
+    // Determine candidate planets
+    Uns16 numPlanets = 0;
+    Uns16 lastPlanet = 0;
+    for (Uns16 planetId = 1; planetId <= PLANET_NR; ++planetId) {
+        if (PlanetSet_Contains(&pArgs->Planets, planetId)) {
+            ++numPlanets;
+            lastPlanet = planetId;
+        }
+    }
+
+    if (numPlanets == 1 && !pArgs->AllEligible) {
+        CommandTable_Add(pInfo->pTable, pRace, Verb_Build, lastPlanet, 0, pInfo->Source);
+        return;
+    }
+
+    // Bulk command: build mask of owned planets in one pass, and intersect
+    struct PlanetSet mask;
+    memset(&mask, 0, sizeof(mask));
+    for (Uns16 planetId = 1; planetId <= PLANET_NR; ++planetId) {
+        if (State_PlanetOwner(pInfo->pState, planetId) == pRace) {
+            PlanetSet_Add(&mask, planetId);
+        }
+    }
+    if (!pArgs->AllEligible) {
+        for (size_t i = 0; i < PLANET_SET_WORDS; ++i) {
+            mask.Bits[i] &= pArgs->Planets.Bits[i];
+        }
+    }
+
+    Uns16 numAdded = 0, numNotEligible = 0;
+    for (Uns16 planetId = 1; planetId <= PLANET_NR; ++planetId) {
+        if (PlanetSet_Contains(&mask, planetId)) {
+            if (IsBuildEligible(pInfo->pState, pInfo->pConfig, planetId)) {
+                CommandTable_Add(pInfo->pTable, pRace, Verb_Build, planetId, 0, pInfo->Source);
+                ++numAdded;
+            } else {
+                ++numNotEligible;
+            }
+        }
+    }
+    if (pArgs->AllEligible) {
+        LOG_INFO("\t(+) bulk build from %d: %d planets", (int) pRace, (int) numAdded);
+    } else {
+        const Uns16 numNotOwned = (Uns16) (numPlanets - numAdded - numNotEligible);
+        LOG_INFO("\t(+) bulk build from %d: %d planets, %d not owned, %d not eligible",
+                 (int) pRace, (int) numAdded, (int) numNotOwned, (int) numNotEligible);
+        pInfo->pTable->pReport->NumNotOwned[pRace] += numNotOwned;
+        pInfo->pTable->pReport->NumNotEligible[pRace] += numNotEligible;
+    }
+}
+
+/* Report a syntax error. */
+static void ReportSyntaxError(Uns16 pRace, const char* pWholeLine, const struct CommandInfo*const pInfo)
+{
+    LOG_INFO("\t(-) rejected command from %d: '%s' (syntax error)", (int) pRace, pWholeLine);
+    if (CommandReport_AddError(pInfo->pTable->pReport, pRace, pInfo->pConfig)) {
         Message_CommandSyntaxError(pRace, pWholeLine);
     }
 }
 
-static Boolean CheckCommand(Uns16 pRace, const char* pCommand, const char* pArgs, const char* pWholeLine, void* pData)
+/* Execute a parsed command: add it to the command table. */
+static void ExecuteCommand(Uns16 pRace, enum Verb verb, struct CommandArgs* pArgs, const struct CommandInfo*const pInfo)
+{
+    switch (verb) {
+     case Verb_Build:
+        AddBuildCommands(pRace, pArgs, pInfo);
+        break;
+     case Verb_Vote:
+        CommandTable_Add(pInfo->pTable, pRace, Verb_Vote, 0, pArgs->Value, pInfo->Source);
+        break;
+    }
+}
+
+/*
+ *  Pre-parsed Commands: Writing
+ *
+ *  When ingesting, commands are not executed but stored in a per-player file (INGEST_FILE_NAME).
+ *  The file consists of a header,
+ *      8 BYTEs   INGEST_FILE_MAGIC
+ *        WORD    Turn number of state file (State_PreviousTurn) the commands are for
+ *        WORD    Flags (INGEST_HAS_MESSAGES)
+ *  followed by records,
+ *        BYTE    Type (enum RecordType)
+ *        BYTE    Source (enum Source)
+ *        BYTE    Value (vote; all-eligible flag)
+ *        BYTE    Reserved
+ *        WORD    Payload size
+ *      n BYTEs   Payload (planet bitfield; erroneous command text)
+ *  At host time, the file is only used if the turn number matches.
+ *  The file is written under a temporary name (INGEST_TEMP_SUFFIX) and renamed into place when complete,
+ *  so a host run never sees a partial file.
+ */
+
+static const char*const INGEST_FILE_NAME = "cactus%d.cmd";
+static const char*const INGEST_TEMP_SUFFIX = ".tmp";
+static const char INGEST_FILE_MAGIC[8] = { 'C', 'A', 'C', 'T', 'C', 'M', 'D', '1' };
+
+/** File contains the player's legacy message commands; do not read them again.
+    @private */
+#define INGEST_HAS_MESSAGES 1
+
+/** Size of a record header.
+    @private */
+#define INGEST_RECORD_HEADER 6
+
+/** Record type.
+    @private */
+enum RecordType {
+    Record_Vote = 1,
+    Record_Build = 2,
+    Record_Error = 3
+};
+
+/* Write a record to player's ingest file. */
+static void WriteCommandRecord(Uns16 pRace, enum RecordType type, Uns8 value, const char* pData, Uns16 length, const struct CommandInfo*const pInfo)
+{
+    FILE* fp = (pRace <= RACE_NR ? pInfo->IngestFiles[pRace] : 0);
+    if (fp != 0) {
+        char header[INGEST_RECORD_HEADER];
+        header[0] = (char) type;
+        header[1] = (char) pInfo->Source;
+        header[2] = (char) value;
+        header[3] = 0;
+        PutWord(header + 4, length);
+        fwrite(header, 1, sizeof(header), fp);
+        if (length != 0) {
+            fwrite(pData, 1, length, fp);
+        }
+    }
+}
+
+/* Write a build command to player's ingest file. */
+static void WriteBuildRecord(Uns16 pRace, const struct CommandArgs* pArgs, const struct CommandInfo*const pInfo)
 {
-    const struct CommandInfo*const pInfo = pData;
+    char bits[4*PLANET_SET_WORDS];
+    for (size_t i = 0; i < PLANET_SET_WORDS; ++i) {
+        PutWord(bits + 4*i,     (Uns16) (pArgs->Planets.Bits[i] & 0xFFFF));
+        PutWord(bits + 4*i + 2, (Uns16) (pArgs->Planets.Bits[i] >> 16));
+    }
+    WriteCommandRecord(pRace, Record_Build, pArgs->AllEligible, bits, sizeof(bits), pInfo);
+}
 
-    if (strcasecmp(pCommand, "defhw") == 0 || strcasecmp(pCommand, "build") == 0) {
-        // Plant a cactus
-        ProcessBuildCommand(pRace, pArgs, pWholeLine, pInfo);
+/* Dispatch a command: parse arguments and execute or ingest it.
+   Returns false if this is not a command. */
+static Boolean DispatchCommand(Uns16 pRace, const char* pCommand, size_t commandLength, const char* pArgs, const char* pWholeLine, const struct CommandInfo*const pInfo)
+{
+    const struct CommandDefinition* def = FindCommand(pCommand, commandLength);
+    if (def == 0 || (def->Sources & (1 << pInfo->Source)) == 0) {
+        return False;
+    }
+
+    struct CommandArgs args;
+    memset(&args, 0, sizeof(args));
+    switch (def->ParseArgs(pArgs, &args)) {
+     case Parse_Ok:
+        if (!pInfo->Ingest) {
+            ExecuteCommand(pRace, def->Verb, &args, pInfo);
+        } else if (def->Verb == Verb_Build) {
+            WriteBuildRecord(pRace, &args, pInfo);
+        } else {
+            WriteCommandRecord(pRace, Record_Vote, args.Value, 0, 0, pInfo);
+        }
         return True;
-    } else if (strcasecmp(pCommand, "vote") == 0) {
-        // Vote for end
-        ProcessVoteCommand(pRace, pArgs, pWholeLine, pInfo);
+     case Parse_Error:
+        if (!pInfo->Ingest) {
+            ReportSyntaxError(pRace, pWholeLine, pInfo);
+        } else {
+            WriteCommandRecord(pRace, Record_Error, 0, pWholeLine, (Uns16) MIN(strlen(pWholeLine), 1000U), pInfo);
+        }
         return True;
-    } else {
-        return False;
+     case Parse_Ignore:
+        break;
     }
+    return False;
 }
 
-void ProcessCommands(struct State* pState, const struct Config* pConfig)
+static Boolean CheckCommand(Uns16 pRace, const char* pCommand, const char* pArgs, const char* pWholeLine, void* pData)
 {
-    struct CommandInfo info;
-    info.pState = pState;
-    info.pConfig = pConfig;
-
-    Info("    Checking commands...");
-    CommandFileReader(0 /* all players */,
-                      CheckCommand,
-                      0 /* CommandComplain_Func */,
-                      "cactus",
-                      0 /* pPrivateFile */,
-                      &info);
+    return DispatchCommand(pRace, pCommand, strlen(pCommand), pArgs, pWholeLine, pData);
 }
 
 /*
@@ -87,135 +586,437 @@ void ProcessCommands(struct State* pState, const struct Config* pConfig)
 
 static void CheckMessageLine(Uns16 pRace, const char* line, void* pData)
 {
-    const char* arg;
-    if ((arg = StrStartsWith(line, "defhw ")) != 0 ||
-        (arg = StrStartsWith(line, "build ")) != 0 ||
-        (arg = StrStartsWith(line, "OBJECT: Planet ")) != 0)
-    {
-        ProcessBuildCommand(pRace, arg, line, pData);
-    } else if ((arg = StrStartsWith(line, "vote ")) != 0) {
-        ProcessVoteCommand(pRace, arg, line, pData);
-    } else {
-        // Ignore.
+    const struct CommandInfo* pInfo = pData;
+    if ((pInfo->SkipMessages & (1 << pRace)) != 0) {
+        return;
+    }
+
+    // Command is first word; must be followed by a space.
+    size_t length = strcspn(line, " ");
+    if (length != 0 && line[length] == ' ') {
+        const char* arg = line + length;
+        while (*arg == ' ') {
+            ++arg;
+        }
+        DispatchCommand(pRace, line, length, arg, line, pData);
     }
 }
 
-static const char* ReadMessageLine(char** data, size_t* size)
-{
-    const char* result = *data;
+/** Message header from messpnt.tmp.
+    @private */
+struct MessageHeader {
+    Uns16 Receiver;
+    char ReceiverChar;
+    size_t Position;
+    size_t Length;
+};
 
-    // Skip over line
-    while (*size != 0 && **data != MSG_TERMINATOR) {
-        **data -= MSG_OFFSET;
-        ++*data;
-        --*size;
+/* Decode message text.
+   Every byte is offset by MSG_OFFSET; MSG_TERMINATOR decodes to a carriage return.
+   This is a plain loop over the whole message which the compiler can vectorize. */
+static void DecodeMessage(char* dst, const char* src, size_t size)
+{
+    for (size_t i = 0; i < size; ++i) {
+        dst[i] = (char) (src[i] - MSG_OFFSET);
     }
+}
 
-    // If we have data remaining, we're looking at a MSG_TERMINATOR.
-    // Replace by null byte and return.
-    if (*size != 0) {
-        **data = '\0';
-        ++*data;
-        --*size;
-        return result;
-    } else {
-        // Partial line: cannot return because there's no space for the null terminator
-        // (or we ended the message already).
-        return 0;
+/* Check whether encoded message text is a message-to-self, i.e. starts with "(-rX)". */
+static Boolean IsMessageToSelf(const char* src, size_t size, char recvChar)
+{
+    return size >= 4
+        && src[0] == '(' + MSG_OFFSET
+        && src[1] == '-' + MSG_OFFSET
+        && src[2] == 'r' + MSG_OFFSET
+        && tolower((unsigned char) (src[3] - MSG_OFFSET)) == recvChar;
+}
+
+/* Parse and validate message headers.
+   Returns number of valid headers; stops at the first invalid one. */
+static Uns16 ReadMessageHeaders(const char* pointers, size_t pointerSize, size_t dataSize, struct MessageHeader* headers, Uns16 numMessages)
+{
+    enum { Receiver, AddressLo, AddressHi, Length };
+    for (Uns16 i = 0; i < numMessages; ++i) {
+        // Single header
+        const size_t headerPos = 2 + 8*(size_t)i;
+        if (headerPos + 8 > pointerSize) {
+            LOG_WARNING("Unable to read header of message %d", (int) i);
+            return i;
+        }
+        Uns16 header[4];
+        for (int j = 0; j < 4; ++j) {
+            header[j] = GetWord(pointers + headerPos + 2*j);
+        }
+
+        // Message receiver
+        Uns16 recv = header[Receiver];
+        char recvChar = (recv > 0 && recv < 10 ? '0' + recv
+                         : recv == 10 ? 'a'
+                         : recv == 11 ? 'b'
+                         : '\0');
+        if (recvChar == '\0') {
+            LOG_WARNING("Invalid receiver for message %d", (int) i);
+            return i;
+        }
+
+        // Message position
+        Uns32 pos = (Uns32)header[AddressLo] + (65536*header[AddressHi]);
+        if (pos == 0) {
+            LOG_WARNING("Invalid position for message %d", (int) i);
+            return i;
+        }
+        if (pos-1 > dataSize || header[Length] > dataSize - (pos-1)) {
+            LOG_WARNING("Unable to read message %d", (int) i);
+            return i;
+        }
+
+        headers[i].Receiver = recv;
+        headers[i].ReceiverChar = recvChar;
+        headers[i].Position = pos-1;
+        headers[i].Length = header[Length];
     }
+    return numMessages;
 }
 
 /* Sort-of generic message file reader.
-   Reads mess.tmp/messpnt.tmp, and forwards message-to-self to func(), line-by-line */
+   Reads mess.tmp/messpnt.tmp, and forwards message-to-self to func(), line-by-line.
+
+   Both files are read in one go. All messages-to-self are decoded into a single buffer,
+   where lines are null-terminated in-place and passed to func() without further copying. */
 static void MessageFileReader(void func(Uns16, const char*, void*), void* pData)
 {
-    // Open files
-    FILE* pointerFile = OpenInputFile("messpnt.tmp", GAME_DIR_ONLY | NO_MISSING_ERROR);
-    FILE* dataFile = OpenInputFile("mess.tmp", GAME_DIR_ONLY | NO_MISSING_ERROR);
+    // Read files
+    size_t pointerSize = 0, dataSize = 0;
+    char* pointers = ReadWholeFile("messpnt.tmp", GAME_DIR_ONLY, &pointerSize);
+    char* data = ReadWholeFile("mess.tmp", GAME_DIR_ONLY, &dataSize);
 
-    // Process files
-    if (pointerFile != 0 && dataFile != 0) {
-        // Read count
-        Uns16 numMessages;
-        if (!DOSRead16(&numMessages, 1, pointerFile)) {
-            numMessages = 0;
-        }
+    if (pointers != 0 && data != 0) {
+        // Validate headers
+        Uns16 numMessages = (pointerSize >= 2 ? GetWord(pointers) : 0);
+        struct MessageHeader* headers = MemAlloc(sizeof(struct MessageHeader) * (numMessages + 1));
+        numMessages = ReadMessageHeaders(pointers, pointerSize, dataSize, headers, numMessages);
 
-        // Read messages
+        // Decode messages-to-self into a single buffer, each followed by a null byte
+        size_t arenaSize = 0;
         for (Uns16 i = 0; i < numMessages; ++i) {
-            // Single header
-            enum { Receiver, AddressLo, AddressHi, Length };
-            Uns16 header[4];
-            if (!DOSRead16(header, 4, pointerFile)) {
-                Warning("Unable to read header of message %d", (int) i);
-                break;
+            if (IsMessageToSelf(data + headers[i].Position, headers[i].Length, headers[i].ReceiverChar)) {
+                arenaSize += headers[i].Length + 1;
             }
+        }
+        char* arena = MemAlloc(arenaSize + 1);
+        char* out = arena;
+        for (Uns16 i = 0; i < numMessages; ++i) {
+            const size_t len = headers[i].Length;
+            if (IsMessageToSelf(data + headers[i].Position, len, headers[i].ReceiverChar)) {
+                DecodeMessage(out, data + headers[i].Position, len);
+                out[len] = '\0';
 
-            // Message receiver
-            Uns16 recv = header[Receiver];
-            char recvChar = (recv > 0 && recv < 10 ? '0' + recv
-                             : recv == 10 ? 'a'
-                             : recv == 11 ? 'b'
-                             : '\0');
-            if (recvChar == '\0') {
-                Warning("Invalid receiver for message %d", (int) i);
-                break;
+                // Split into lines. First line is the "(-r" header; skip that.
+                const char separator = MSG_TERMINATOR - MSG_OFFSET;
+                char* line = 0;
+                for (size_t j = 0; j <= len; ++j) {
+                    if (j == len || out[j] == separator) {
+                        out[j] = '\0';
+                        if (line != 0) {
+                            func(headers[i].Receiver, line, pData);
+                        }
+                        line = out + j + 1;
+                    }
+                }
+                out += len + 1;
             }
+        }
 
-            // Message position
-            Uns32 pos = (Uns32)header[AddressLo] + (65536*header[AddressHi]);
-            if (pos == 0) {
-                Warning("Invalid position for message %d", (int) i);
-                break;
-            }
-            if (fseek(dataFile, pos-1, SEEK_SET) != 0) {
-                Warning("Unable to set position for message %d", (int) i);
-                break;
+        MemFree(arena);
+        MemFree(headers);
+    }
+
+    // Release files
+    if (pointers != 0) {
+        MemFree(pointers);
+    }
+    if (data != 0) {
+        MemFree(data);
+    }
+}
+
+/*
+ *  Pre-parsed Commands: Reading
+ */
+
+/* Execute a single record from an ingest file. */
+static void ExecuteCommandRecord(Uns16 pRace, Uns8 type, const char* pData, Uns16 length, Uns8 value, const struct CommandInfo*const pInfo)
+{
+    struct CommandArgs args;
+    memset(&args, 0, sizeof(args));
+    switch (type) {
+     case Record_Vote:
+        args.Value = value;
+        ExecuteCommand(pRace, Verb_Vote, &args, pInfo);
+        break;
+
+     case Record_Build:
+        if (length == sizeof(args.Planets.Bits)) {
+            for (size_t i = 0; i < PLANET_SET_WORDS; ++i) {
+                args.Planets.Bits[i] = GetWord(pData + 4*i) + 65536UL*GetWord(pData + 4*i + 2);
             }
+            args.AllEligible = (value != 0);
+            ExecuteCommand(pRace, Verb_Build, &args, pInfo);
+        }
+        break;
 
-            // Message content
-            char data[1000];
-            size_t size = MIN(sizeof(data)-1, header[Length]);
-            if (fread(data, 1, size, dataFile) != size) {
-                Warning("Unable to read message %d", (int) i);
-                break;
+     case Record_Error: {
+        char* line = MemAlloc(length + 1U);
+        memcpy(line, pData, length);
+        line[length] = '\0';
+        ReportSyntaxError(pRace, line, pInfo);
+        MemFree(line);
+        break;
+     }
+    }
+}
+
+/* Check records of an ingest file. Returns true if all are complete and well-formed. */
+static Boolean CheckCommandRecords(const char* data, size_t size, size_t pos)
+{
+    while (pos < size) {
+        if (size - pos < INGEST_RECORD_HEADER) {
+            return False;
+        }
+        const char* header = data + pos;
+        const Uns16 length = GetWord(header + 4);
+        if (length > size - pos - INGEST_RECORD_HEADER) {
+            return False;
+        }
+        switch ((Uns8) header[0]) {
+         case Record_Vote:
+         case Record_Error:
+            break;
+         case Record_Build:
+            if (length != 4*PLANET_SET_WORDS) {
+                return False;
             }
+            break;
+         default:
+            return False;
+        }
+        pos += INGEST_RECORD_HEADER + length;
+    }
+    return True;
+}
 
-            // Terminate it, so ReadMessageLine can extract lines
-            data[size++] = MSG_TERMINATOR;
-
-            // Read it
-            char* p = data;
-            const char* firstLine = ReadMessageLine(&p, &size);
-            if (firstLine[0] == '('
-                && firstLine[1] == '-'
-                && firstLine[2] == 'r'
-                && tolower((unsigned char) firstLine[3]) == recvChar)
-            {
-                // It's a message-to-self; parse it.
-                const char* line;
-                while ((line = ReadMessageLine(&p, &size)) != 0) {
-                    func(recv, line, pData);
-                }
+/* Load player's ingest file and execute the commands it contains.
+   Returns true if a valid file was found; *pFlags receives its flags.
+   A file with a damaged record is not used at all, so that the player's commands are parsed normally. */
+static Boolean LoadCommandFile(Uns16 pRace, Uns16* pFlags, struct CommandInfo* pInfo)
+{
+    char name[30];
+    sprintf(name, INGEST_FILE_NAME, (int) pRace);
+
+    size_t size;
+    char* data = ReadWholeFile(name, GAME_DIR_ONLY, &size);
+    if (data == 0) {
+        return False;
+    }
+
+    const size_t start = sizeof(INGEST_FILE_MAGIC) + 4;
+    Boolean ok = (size >= start
+                  && memcmp(data, INGEST_FILE_MAGIC, sizeof(INGEST_FILE_MAGIC)) == 0
+                  && CheckCommandRecords(data, size, start));
+    if (!ok) {
+        LOG_WARNING("File %s is invalid, ignoring", name);
+    } else if (GetWord(data + sizeof(INGEST_FILE_MAGIC)) != State_PreviousTurn(pInfo->pState)) {
+        LOG_INFO("\t(-) ignoring outdated %s", name);
+        ok = False;
+    } else {
+        *pFlags = GetWord(data + sizeof(INGEST_FILE_MAGIC) + 2);
+        LOG_INFO("\t(+) using pre-parsed commands for player %d", (int) pRace);
+
+        size_t pos = start;
+        while (pos < size) {
+            const char* header = data + pos;
+            Uns16 length = GetWord(header + 4);
+            pInfo->Source = (header[1] == Source_Message ? Source_Message : Source_Command);
+            ExecuteCommandRecord(pRace, (Uns8) header[0], header + INGEST_RECORD_HEADER, length, (Uns8) header[2], pInfo);
+            pos += INGEST_RECORD_HEADER + length;
+        }
+    }
+    MemFree(data);
+    return ok;
+}
+
+/* Create player's ingest file, under its temporary name. */
+static FILE* CreateCommandFile(Uns16 pRace, const struct State* pState, Uns16 flags)
+{
+    char name[30];
+    sprintf(name, INGEST_FILE_NAME, (int) pRace);
+    strcat(name, INGEST_TEMP_SUFFIX);
+
+    FILE* fp = OpenOutputFile(name, GAME_DIR_ONLY | NO_MISSING_ERROR);
+    if (fp != 0) {
+        char header[4];
+        PutWord(header, State_PreviousTurn(pState));
+        PutWord(header + 2, flags);
+        fwrite(INGEST_FILE_MAGIC, 1, sizeof(INGEST_FILE_MAGIC), fp);
+        fwrite(header, 1, sizeof(header), fp);
+    }
+    return fp;
+}
+
+/* Finish player's ingest file and move it into place. Returns true on success. */
+static Boolean CloseCommandFile(Uns16 pRace, FILE* fp)
+{
+    char name[30];
+    char fileName[1024];
+    char tempName[1040];
+    sprintf(name, INGEST_FILE_NAME, (int) pRace);
+    snprintf(fileName, sizeof(fileName), "%s/%s", gGameDirectory, name);
+    snprintf(tempName, sizeof(tempName), "%s%s", fileName, INGEST_TEMP_SUFFIX);
+
+    Boolean ok = (ferror(fp) == 0);
+    if (fclose(fp) != 0) {
+        ok = False;
+    }
+    if (ok && rename(tempName, fileName) != 0) {
+        ok = False;
+    }
+    if (!ok) {
+        remove(tempName);
+        LOG_ERROR("Unable to write pre-parsed commands for player %d", (int) pRace);
+    }
+    return ok;
+}
+
+
+/*
+ *  Public Interface
+ */
+
+Boolean IngestCommands(RaceType_Def player, const struct State* pState, const struct Config* pConfig)
+{
+    const Boolean withMessages = (player == 0 && pConfig->ProcessMessages);
+
+    struct CommandInfo info;
+    memset(&info, 0, sizeof(info));
+    info.pConfig = pConfig;
+    info.pState = pState;
+    info.Ingest = True;
+
+    // Create files
+    Boolean ok = True;
+    for (RaceType_Def i = 1; i <= RACE_NR; ++i) {
+        if (player == 0 || player == i) {
+            info.IngestFiles[i] = CreateCommandFile(i, pState, withMessages ? INGEST_HAS_MESSAGES : 0);
+            if (info.IngestFiles[i] == 0) {
+                ok = False;
             }
         }
     }
 
+    // Parse
+    if (ok) {
+        info.Source = Source_Command;
+        CommandFileReader(player,
+                          CheckCommand,
+                          0 /* CommandComplain_Func */,
+                          "cactus",
+                          0 /* pPrivateFile */,
+                          &info);
+
+        if (withMessages) {
+            info.Source = Source_Message;
+            MessageFileReader(CheckMessageLine, &info);
+        }
+    }
+
     // Close files
-    if (pointerFile != 0) {
-        fclose(pointerFile);
+    for (RaceType_Def i = 1; i <= RACE_NR; ++i) {
+        if (info.IngestFiles[i] != 0 && !CloseCommandFile(i, info.IngestFiles[i])) {
+            ok = False;
+        }
     }
-    if (dataFile != 0) {
-        fclose(dataFile);
+    return ok;
+}
+
+void CommandReport_Init(struct CommandReport* pReport)
+{
+    memset(pReport, 0, sizeof(*pReport));
+}
+
+Boolean CommandReport_AddError(struct CommandReport* pReport, RaceType_Def player, const struct Config* pConfig)
+{
+    ++pReport->NumErrors[player];
+    return pReport->NumErrors[player] <= (Uns32) (pConfig->ErrorMessageLimit > 0 ? pConfig->ErrorMessageLimit : 0);
+}
+
+void CommandReport_Send(const struct CommandReport* pReport, const struct Config* pConfig)
+{
+    const Uns32 limit = (Uns32) (pConfig->ErrorMessageLimit > 0 ? pConfig->ErrorMessageLimit : 0);
+    for (RaceType_Def player = 1; player <= RACE_NR; ++player) {
+        const Uns32 numErrors = pReport->NumErrors[player];
+        const Uns32 numSuppressed = (numErrors > limit ? numErrors - limit : 0);
+        const Uns32 numDropped = pReport->NumDropped[player];
+        const Uns32 numNotOwned = pReport->NumNotOwned[player];
+        const Uns32 numNotEligible = pReport->NumNotEligible[player];
+        if (numSuppressed != 0 || numDropped != 0 || numNotOwned != 0 || numNotEligible != 0) {
+            LOG_INFO("\t(-) player %d: %d errors not reported, %d commands over limit", (int) player, (int) numSuppressed, (int) numDropped);
+            Message_CommandSummary(player, (int) numSuppressed, (int) numDropped, pConfig->CommandLimit, (int) numNotOwned, (int) numNotEligible);
+        }
     }
 }
 
-void ProcessMessages(struct State* pState, const struct Config* pConfig)
+void ProcessCommands(struct State* pState, const struct Config* pConfig, struct CommandReport* pReport)
 {
+    struct CommandTable table;
+    CommandTable_Init(&table, pReport);
+
     struct CommandInfo info;
-    info.pState = pState;
+    memset(&info, 0, sizeof(info));
+    info.pTable = &table;
     info.pConfig = pConfig;
+    info.pState = pState;
+
+    LOG_PHASE("    Checking commands...");
+
+    // Pre-parsed commands
+    Uns16 playersWithFile = 0;
+    for (RaceType_Def player = 1; player <= RACE_NR; ++player) {
+        Uns16 flags = 0;
+        if (LoadCommandFile(player, &flags, &info)) {
+            playersWithFile |= (Uns16) (1 << player);
+            if ((flags & INGEST_HAS_MESSAGES) != 0) {
+                info.SkipMessages |= (Uns16) (1 << player);
+            }
+        }
+    }
+
+    // Regular commands for everyone else
+    info.Source = Source_Command;
+    if (playersWithFile == 0) {
+        CommandFileReader(0 /* all players */,
+                          CheckCommand,
+                          0 /* CommandComplain_Func */,
+                          "cactus",
+                          0 /* pPrivateFile */,
+                          &info);
+    } else {
+        for (RaceType_Def player = 1; player <= RACE_NR; ++player) {
+            if ((playersWithFile & (1 << player)) == 0) {
+                CommandFileReader(player, CheckCommand, 0, "cactus", 0, &info);
+            }
+        }
+    }
+
+    const Uns16 allPlayers = (Uns16) (((1 << RACE_NR) - 1) << 1);
+    if (pConfig->ProcessMessages && info.SkipMessages != allPlayers) {
+        Stats_Phase("messages");
+        LOG_PHASE("    Checking legacy commands...");
+        info.Source = Source_Message;
+        MessageFileReader(CheckMessageLine, &info);
+        Stats_Phase("commands");
+    }
 
-    Info("    Checking legacy commands...");
-    MessageFileReader(CheckMessageLine, &info);
+    CommandTable_Normalize(&table);
+    CommandTable_Apply(&table, pState, pConfig);
+    CommandTable_Free(&table);
 }
@@ -8,24 +8,65 @@
 #include "config.h"
 #include "state.h"
 
+/** Per-player error report.
+    Failed commands and builds are counted here so that they share a player's ErrorMessageLimit;
+    CommandReport_Send() summarizes everything that was not reported individually. */
+struct CommandReport {
+    Uns32 NumErrors[RACE_NR+1];         ///< Number of failed commands and builds.
+    Uns32 NumDropped[RACE_NR+1];        ///< Number of commands ignored due to CommandLimit.
+    Uns32 NumNotOwned[RACE_NR+1];       ///< Number of planets skipped in bulk build commands because not owned.
+    Uns32 NumNotEligible[RACE_NR+1];    ///< Number of planets skipped in bulk build commands because not eligible.
+};
+
+/** Initialize error report.
+    @param [out] pReport  Report */
+void CommandReport_Init(struct CommandReport* pReport);
+
+/** Count a failed command or build.
+    @param [in,out] pReport  Report
+    @param [in]     player   Player
+    @param [in]     pConfig  Configuration
+    @return true if the player shall receive an individual message for it,
+            false if it shall only be counted for the summary */
+Boolean CommandReport_AddError(struct CommandReport* pReport, RaceType_Def player, const struct Config* pConfig);
+
+/** Send summary of unreported errors, dropped commands and skipped planets to each affected player.
+    @param [in] pReport  Report
+    @param [in] pConfig  Configuration */
+void CommandReport_Send(const struct CommandReport* pReport, const struct Config* pConfig);
+
 /** Process commands.
     Reads all commands given by players and updates them in pState.
+    Commands are read from the command processor (or pre-parsed files created by IngestCommands())
+    and, if enabled, from messages (legacy message processing).
+    They are collected in a command table, deduplicated, and applied in a deterministic order;
+    conflicting commands are resolved in favor of command processor over messages, and later over earlier ones.
 
     Commands are verified against pState (=previous turn's state),
     not the current universe state.
 
+    Rejected and dropped commands are counted in pReport;
+    the caller sends the summary with CommandReport_Send() once building is done.
+
     @param [in,out] pState   Game state
-    @param [in]     pConfig  Configuration */
-void ProcessCommands(struct State* pState, const struct Config* pConfig);
+    @param [in]     pConfig  Configuration
+    @param [in,out] pReport  Error report */
+void ProcessCommands(struct State* pState, const struct Config* pConfig, struct CommandReport* pReport);
 
-/** Process messages (legacy message processing).
-    Reads all messages given by players and updates them in pState.
+/** Ingest commands.
+    Parses commands from the command processor and stores them in pre-parsed form
+    (one file `cactusN.cmd` per player).
+    At host time, ProcessCommands() uses the pre-parsed file instead of re-reading the commands,
+    provided it was created for the same turn.
 
-    Messages are verified against pState (=previous turn's state),
-    not the current universe state.
+    For a single player, this is intended to be run when the player uploads a turn.
+    For all players, this is intended to be run at AUXHOST1;
+    in this case, legacy message commands are also ingested if enabled.
 
-    @param [in,out] pState   Game state
-    @param [in]     pConfig  Configuration */
-void ProcessMessages(struct State* pState, const struct Config* pConfig);
+    @param [in] player  Player; 0 for all players
+    @param [in] pState  Game state (previous turn), identifies the turn
+    @param [in] pConfig Configuration
+    @return true on success */
+Boolean IngestCommands(RaceType_Def player, const struct State* pState, const struct Config* pConfig);
 
 #endif
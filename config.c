@@ -7,6 +7,9 @@
 #include <string.h>
 #include <strings.h>        // strcasecmp according to SuS
 #include "config.h"
+#include "log.h"
+#include "stats.h"
+#include "util.h"
 
 /*
  *  Definition of config layout
@@ -14,6 +17,10 @@
 
 static const char*const CONFIG_FILE_NAME = "cactus.ini";
 static const char*const CONFIG_FILE_SECTION = "CACTUS";
+static const char*const CONFIG_CACHE_FILE_NAME = "cactus.cfc";
+static const char*const CONFIG_CACHE_TEMP_NAME = "cactus.cfc.tmp";
+static const char*const CONFIG_PRESET_KEY = "Preset";
+static const char CONFIG_CACHE_MAGIC[8] = { 'C', 'A', 'C', 'T', 'C', 'F', 'G', '1' };
 
 /** Configuration element type.
     @private */
@@ -26,17 +33,25 @@ enum Type {
     @private */
 struct Definition {
     const char* Name;
-    enum Type   Type : 16;
+    enum Type   Type : 8;
+    Boolean     HostOnly : 8;           ///< True if not shown to players.
     size_t      Offset : 16;
 };
 
 /** Define configuration element.
     @private */
-#define CONFIG(type, x) { #x, t##type, offsetof(struct Config, x) }
+#define CONFIG(type, x) { #x, t##type, False, offsetof(struct Config, x) }
+
+/** Define configuration element that only concerns the host.
+    @private */
+#define CONFIG_HOST(type, x) { #x, t##type, True, offsetof(struct Config, x) }
 
 static const struct Definition CONFIG_DEFINITION[] = {
     CONFIG(Boolean, KeepCactus),
     CONFIG(Boolean, ProcessMessages),
+    CONFIG(Int16, CommandLimit),
+    CONFIG(Int16, ErrorMessageLimit),
+    CONFIG_HOST(Int16, LogLevel),
     CONFIG(Int16, TurnScore),
     CONFIG(Int16, TurnOwnerScore),
     CONFIG(Int16, TurnPlusScore),
@@ -56,8 +71,33 @@ static const struct Definition CONFIG_DEFINITION[] = {
     CONFIG(Int16, VoteTurn),
     CONFIG(Int16, FinishPercent),
     CONFIG(Int16, FinishScore),
+    CONFIG(Boolean, LegacyCactusRecords),
+    CONFIG(Boolean, DeltaInventory),
+    CONFIG(Int16, FullInventoryTurns),
+    CONFIG(Boolean, CompactInventory),
 };
 
+/** Number of configuration elements.
+    @private */
+#define NUM_DEFINITIONS (sizeof(CONFIG_DEFINITION)/sizeof(CONFIG_DEFINITION[0]))
+
+/** Size of key lookup table.
+    Must be a power of 2, and at least twice NUM_DEFINITIONS to keep probe sequences short.
+    @private */
+#define LOOKUP_SIZE 64
+
+/** Maximum length of a preset file name, including the terminating null.
+    @private */
+#define PRESET_NAME_SIZE 32
+
+/** Offset of first value in cache file.
+    @private */
+#define CACHE_VALUE_OFFSET 60
+
+/** Size of cache file.
+    @private */
+#define CACHE_FILE_SIZE (CACHE_VALUE_OFFSET + 2*NUM_DEFINITIONS)
+
 /*
  *  Internal
  *
@@ -65,7 +105,94 @@ static const struct Definition CONFIG_DEFINITION[] = {
  *  The latter is documented for `CactusLimit`.
  */
 
-static struct Config* gConfig;
+/** Identification of a configuration file's content.
+    @private */
+struct FileKey {
+    Uns32 Size;                         ///< File size.
+    Uns32 Hash;                         ///< Hash of content.
+};
+
+/** Configuration file being read.
+    @private */
+struct Layer {
+    struct Config* Config;              ///< Target configuration.
+    Boolean IsSet[NUM_DEFINITIONS];     ///< For each definition, true if it was assigned.
+    Boolean AllowPreset;                ///< True if this file can name a preset.
+    char Preset[PRESET_NAME_SIZE];      ///< Name of preset; empty if none.
+};
+
+static struct Layer* gLayer;
+
+/* Key lookup table. Index into CONFIG_DEFINITION plus 1; 0 if slot is unused. */
+static Uns8 gLookup[LOOKUP_SIZE];
+
+/* Hash of the configuration layout, to invalidate caches when it changes. 0 if not yet initialized. */
+static Uns32 gSchemaHash;
+
+/* Hash a key, ignoring case. */
+static Uns32 HashKey(const char* name)
+{
+    return HashBytesNoCase(HASH_INIT, name, strlen(name));
+}
+
+/* Build key lookup table and schema hash on first use. */
+static void InitLookup(void)
+{
+    if (gSchemaHash == 0) {
+        Uns32 h = HASH_INIT;
+        for (size_t i = 0; i < NUM_DEFINITIONS; ++i) {
+            const struct Definition* def = &CONFIG_DEFINITION[i];
+            size_t slot = HashKey(def->Name) & (LOOKUP_SIZE-1);
+            while (gLookup[slot] != 0) {
+                slot = (slot+1) & (LOOKUP_SIZE-1);
+            }
+            gLookup[slot] = (Uns8) (i+1);
+
+            const char type = (char) def->Type;
+            h = HashBytes(h, def->Name, strlen(def->Name) + 1);
+            h = HashBytes(h, &type, 1);
+        }
+        gSchemaHash = (h != 0 ? h : 1);
+    }
+}
+
+/* Find configuration element by name. Returns its index, or -1 if not found. */
+static int FindDefinition(const char* name)
+{
+    InitLookup();
+    size_t slot = HashKey(name) & (LOOKUP_SIZE-1);
+    while (gLookup[slot] != 0) {
+        const int index = gLookup[slot] - 1;
+        if (strcasecmp(name, CONFIG_DEFINITION[index].Name) == 0) {
+            return index;
+        }
+        slot = (slot+1) & (LOOKUP_SIZE-1);
+    }
+    return -1;
+}
+
+static int GetValue(const struct Config* p, const struct Definition* def)
+{
+    switch (def->Type) {
+     case tBoolean:
+        return *(const Boolean*) ((const char*)p + def->Offset);
+     case tInt16:
+        return *(const Int16*) ((const char*)p + def->Offset);
+    }
+    return 0;
+}
+
+static void SetValue(struct Config* p, const struct Definition* def, int value)
+{
+    switch (def->Type) {
+     case tBoolean:
+        *(Boolean*) ((char*)p + def->Offset) = (value != 0);
+        break;
+     case tInt16:
+        *(Int16*) ((char*)p + def->Offset) = (Int16) value;
+        break;
+    }
+}
 
 static Boolean AssignInt16(Int16* p, const char* value)
 {
@@ -98,25 +225,171 @@ static Boolean AssignBoolean(Boolean* p, const char* value)
     }
 }
 
+static Boolean AssignPreset(char* rhs)
+{
+    // Preset must be a plain file name in the root directory
+    if (!gLayer->AllowPreset || rhs[0] == '\0' || rhs[0] == '.' || strlen(rhs) >= PRESET_NAME_SIZE || strpbrk(rhs, "/\\:") != 0) {
+        return False;
+    }
+    strcpy(gLayer->Preset, rhs);
+    return True;
+}
+
 static Boolean AssignGlobalConfig(const char* lhs, char* rhs, const char* line)
 {
-    size_t i;
     (void) line;
     if (!lhs || !rhs) {
         return True;
     }
-    for (i = 0; i < sizeof(CONFIG_DEFINITION)/sizeof(CONFIG_DEFINITION[0]); ++i) {
+    if (strcasecmp(lhs, CONFIG_PRESET_KEY) == 0) {
+        return AssignPreset(rhs);
+    }
+
+    const int index = FindDefinition(lhs);
+    if (index < 0) {
+        return False;
+    }
+    const struct Definition* def = &CONFIG_DEFINITION[index];
+    Boolean ok = False;
+    switch (def->Type) {
+     case tBoolean:
+        ok = AssignBoolean((Boolean*) ((char*)gLayer->Config + def->Offset), rhs);
+        break;
+     case tInt16:
+        ok = AssignInt16((Int16*) ((char*)gLayer->Config + def->Offset), rhs);
+        break;
+    }
+    if (ok) {
+        gLayer->IsSet[index] = True;
+    }
+    return ok;
+}
+
+/* Read a configuration file into a layer. */
+static void ReadLayer(FILE* f, const char* fileName, struct Layer* pLayer)
+{
+    // PDK is not reentrant, but we pretend to be.
+    struct Layer* prev = gLayer;
+    gLayer = pLayer;
+    ConfigFileReader(f, fileName, CONFIG_FILE_SECTION, True, AssignGlobalConfig);
+    gLayer = prev;
+}
+
+/* Compute key of a file, and rewind it for reading. */
+static void HashFile(FILE* f, struct FileKey* pKey)
+{
+    char buffer[4096];
+    size_t n;
+    pKey->Size = 0;
+    pKey->Hash = HASH_INIT;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+        pKey->Size += (Uns32) n;
+        pKey->Hash = HashBytes(pKey->Hash, buffer, n);
+    }
+    rewind(f);
+}
+
+/* Open preset file and compute its key. */
+static FILE* OpenPreset(const char* name, struct FileKey* pKey)
+{
+    FILE* f = OpenInputFile(name, ROOT_DIR_ONLY | TEXT_MODE | NO_MISSING_ERROR);
+    if (f != NULL) {
+        HashFile(f, pKey);
+    }
+    return f;
+}
+
+/* Load configuration from cache.
+   Succeeds only if the cache was made from the same configuration layout,
+   configuration file and preset file content. */
+static Boolean LoadCache(struct Config* p, const struct FileKey* pGameKey)
+{
+    // Read entire file; reading one extra byte detects files that are too long
+    char buffer[CACHE_FILE_SIZE + 1];
+    FILE* f = OpenInputFile(CONFIG_CACHE_FILE_NAME, GAME_DIR_ONLY | NO_MISSING_ERROR);
+    if (f == NULL) {
+        return False;
+    }
+    size_t n = fread(buffer, 1, sizeof(buffer), f);
+    fclose(f);
+
+    InitLookup();
+    if (n != CACHE_FILE_SIZE
+        || memcmp(buffer, CONFIG_CACHE_MAGIC, sizeof(CONFIG_CACHE_MAGIC)) != 0
+        || GetLong(buffer + 8) != gSchemaHash
+        || GetLong(buffer + 12) != pGameKey->Size
+        || GetLong(buffer + 16) != pGameKey->Hash
+        || buffer[20 + PRESET_NAME_SIZE - 1] != '\0')
+    {
+        return False;
+    }
+
+    const char* presetName = buffer + 20;
+    if (presetName[0] != '\0') {
+        struct FileKey presetKey;
+        FILE* pf = OpenPreset(presetName, &presetKey);
+        if (pf == NULL) {
+            return False;
+        }
+        fclose(pf);
+        if (GetLong(buffer + 52) != presetKey.Size || GetLong(buffer + 56) != presetKey.Hash) {
+            return False;
+        }
+    }
+
+    struct Config c;
+    for (size_t i = 0; i < NUM_DEFINITIONS; ++i) {
         const struct Definition* def = &CONFIG_DEFINITION[i];
-        if (strcasecmp(lhs, def->Name) == 0) {
-            switch (def->Type) {
-             case tBoolean:
-                return AssignBoolean((Boolean*) ((char*)gConfig + def->Offset), rhs);
-             case tInt16:
-                return AssignInt16((Int16*) ((char*)gConfig + def->Offset), rhs);
-            }
+        const Uns16 value = GetWord(buffer + CACHE_VALUE_OFFSET + 2*i);
+        if (def->Type == tBoolean && value > 1) {
+            return False;
         }
+        SetValue(&c, def, (Int16) value);
+    }
+    *p = c;
+    return True;
+}
+
+/* Save configuration to cache. */
+static void SaveCache(const struct Config* p, const struct FileKey* pGameKey, const char* presetName, const struct FileKey* pPresetKey)
+{
+    char buffer[CACHE_FILE_SIZE];
+    memset(buffer, 0, sizeof(buffer));
+    InitLookup();
+    memcpy(buffer, CONFIG_CACHE_MAGIC, sizeof(CONFIG_CACHE_MAGIC));
+    PutLong(buffer + 8, gSchemaHash);
+    PutLong(buffer + 12, pGameKey->Size);
+    PutLong(buffer + 16, pGameKey->Hash);
+    strcpy(buffer + 20, presetName);
+    PutLong(buffer + 52, pPresetKey->Size);
+    PutLong(buffer + 56, pPresetKey->Hash);
+    for (size_t i = 0; i < NUM_DEFINITIONS; ++i) {
+        PutWord(buffer + CACHE_VALUE_OFFSET + 2*i, (Uns16) GetValue(p, &CONFIG_DEFINITION[i]));
+    }
+
+    // Write under a temporary name and move into place, so concurrent runs never see a partial file.
+    FILE* f = OpenOutputFile(CONFIG_CACHE_TEMP_NAME, GAME_DIR_ONLY | NO_MISSING_ERROR);
+    if (f == NULL) {
+        LOG_WARNING("Unable to write %s", CONFIG_CACHE_FILE_NAME);
+        return;
+    }
+    Boolean ok = (fwrite(buffer, 1, sizeof(buffer), f) == sizeof(buffer));
+    Stats_AddFile(f);
+    if (fclose(f) != 0) {
+        ok = False;
+    }
+
+    char fileName[1024];
+    char tempName[1024];
+    snprintf(fileName, sizeof(fileName), "%s/%s", gGameDirectory, CONFIG_CACHE_FILE_NAME);
+    snprintf(tempName, sizeof(tempName), "%s/%s", gGameDirectory, CONFIG_CACHE_TEMP_NAME);
+    if (ok && rename(tempName, fileName) != 0) {
+        ok = False;
+    }
+    if (!ok) {
+        remove(tempName);
+        LOG_WARNING("Unable to write %s", CONFIG_CACHE_FILE_NAME);
     }
-    return False;
 }
 
 
@@ -129,6 +402,9 @@ void Config_Init(struct Config* p)
     // General
     p->KeepCactus = False;
     p->ProcessMessages = True;
+    p->CommandLimit = 0;
+    p->ErrorMessageLimit = 10;
+    p->LogLevel = LOG_LEVEL_INFO;
 
     // Scoring
     p->TurnScore = 1;
@@ -154,43 +430,83 @@ void Config_Init(struct Config* p)
     p->VoteTurn = 65;
     p->FinishPercent = 66;
     p->FinishScore = 2000;
+
+    // Reporting
+    p->LegacyCactusRecords = False;
+    p->DeltaInventory = False;
+    p->FullInventoryTurns = 10;
+    p->CompactInventory = False;
 }
 
-void Config_Load(struct Config* p)
+void Config_Load(struct Config* p, Boolean updateCache)
 {
-    FILE* f;
-    struct Config* prev;
-
     Config_Init(p);
 
-    f = OpenInputFile(CONFIG_FILE_NAME, GAME_DIR_ONLY | TEXT_MODE | NO_MISSING_ERROR);
+    FILE* f = OpenInputFile(CONFIG_FILE_NAME, GAME_DIR_ONLY | TEXT_MODE | NO_MISSING_ERROR);
     if (f == NULL) {
-        Warning("Configuration file (%s) not found, using defaults.", CONFIG_FILE_NAME);
+        LOG_WARNING("Configuration file (%s) not found, using defaults.", CONFIG_FILE_NAME);
         return;
     }
 
-    // PDK is not reentrant, but we pretend to be.
-    prev = gConfig;
-    gConfig = p;
-    ConfigFileReader(f, CONFIG_FILE_NAME, CONFIG_FILE_SECTION, True, AssignGlobalConfig);
-    gConfig = prev;
+    struct FileKey gameKey;
+    HashFile(f, &gameKey);
+    if (LoadCache(p, &gameKey)) {
+        fclose(f);
+        return;
+    }
 
+    // Game configuration, on top of defaults
+    struct Config gameConfig;
+    struct Layer game;
+    memset(&game, 0, sizeof(game));
+    Config_Init(&gameConfig);
+    game.Config = &gameConfig;
+    game.AllowPreset = True;
+    ReadLayer(f, CONFIG_FILE_NAME, &game);
     fclose(f);
+
+    // Preset, on top of defaults
+    struct FileKey presetKey;
+    memset(&presetKey, 0, sizeof(presetKey));
+    if (game.Preset[0] != '\0') {
+        FILE* pf = OpenPreset(game.Preset, &presetKey);
+        if (pf == NULL) {
+            LOG_WARNING("Preset file (%s) not found, ignoring.", game.Preset);
+            updateCache = False;
+        } else {
+            struct Layer preset;
+            memset(&preset, 0, sizeof(preset));
+            preset.Config = p;
+            ReadLayer(pf, game.Preset, &preset);
+            fclose(pf);
+        }
+    }
+
+    // Values set by game configuration override preset
+    for (size_t i = 0; i < NUM_DEFINITIONS; ++i) {
+        if (game.IsSet[i]) {
+            SetValue(p, &CONFIG_DEFINITION[i], GetValue(&gameConfig, &CONFIG_DEFINITION[i]));
+        }
+    }
+
+    if (updateCache) {
+        SaveCache(p, &gameKey, game.Preset, &presetKey);
+    }
 }
 
-void Config_Format(const struct Config* p, void func(void* state, const char* name, const char* value), void* state)
+void Config_Format(const struct Config* p, Boolean includeHostOnly, void func(void* state, const char* name, const char* value), void* state)
 {
-    size_t i;
-    for (i = 0; i < sizeof(CONFIG_DEFINITION)/sizeof(CONFIG_DEFINITION[0]); ++i) {
+    for (size_t i = 0; i < NUM_DEFINITIONS; ++i) {
         const struct Definition* def = &CONFIG_DEFINITION[i];
+        if (def->HostOnly && !includeHostOnly) {
+            continue;
+        }
+        const int value = GetValue(p, def);
         switch (def->Type) {
-         case tBoolean: {
-            Boolean value = *(Boolean*) ((char*)p + def->Offset);
+         case tBoolean:
             func(state, def->Name, value ? "Yes" : "No");
             break;
-         }
          case tInt16: {
-            Int16 value = *(Int16*) ((char*)p + def->Offset);
             char tmp[20];
             snprintf(tmp, sizeof(tmp), "%d", value);
             func(state, def->Name, tmp);
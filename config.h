@@ -13,6 +13,9 @@ struct Config {
     // General
     Boolean KeepCactus;                 ///< True to support cactus stumps.
     Boolean ProcessMessages;            ///< True to process messages; false to process only commands.
+    Int16 CommandLimit;                 ///< Maximum number of commands per player and turn.
+    Int16 ErrorMessageLimit;            ///< Maximum number of individual error messages per player and turn.
+    Int16 LogLevel;                     ///< Log level (LOG_LEVEL_XXX).
 
     // Scoring
     Int16 TurnScore;                    ///< Points per turn for normal cactus.
@@ -38,6 +41,12 @@ struct Config {
     Int16 VoteTurn;                     ///< Turn when to enable voting.
     Int16 FinishPercent;                ///< Percentage of votes that ends the game.
     Int16 FinishScore;                  ///< Game ends when player reaches this score.
+
+    // Reporting
+    Boolean LegacyCactusRecords;        ///< True to also send one util.dat record per cactus.
+    Boolean DeltaInventory;             ///< True to report only inventory changes.
+    Int16 FullInventoryTurns;           ///< With DeltaInventory, send full inventory every this many turns.
+    Boolean CompactInventory;           ///< True to report multiple cactuses per line.
 };
 
 /** Initialize configuration.
@@ -45,17 +54,25 @@ struct Config {
 void Config_Init(struct Config* p);
 
 /** Load configuration.
-    @param [out] p Configuration structure; will be set with loaded values.
+    Reads `cactus.ini` from the game directory.
+    If that names a `Preset`, the preset file is read from the root directory first,
+    and the game's values override it.
+
+    The result is cached in `cactus.cfc`, together with the size and hash of the files it was made from.
+    If those are unchanged, the configuration is taken from the cache without parsing.
+    @param [out] p           Configuration structure; will be set with loaded values.
+    @param [in]  updateCache True to write the cache if it was not valid
     @pre PDK initialized (gGameDirectory set) */
-void Config_Load(struct Config* p);
+void Config_Load(struct Config* p, Boolean updateCache);
 
 /** Format configuration.
     Calls the provided callback function for each configuration key,
     passing it the name and stringified value.
     This can be used for printing or sending messages.
     @param [in] p     Configuration
+    @param [in] includeHostOnly True to include keys that only concern the host (LogLevel); false for output to players
     @param [in] func  Callback function
     @param [in] state Opaque state pointer that is passed to the callback function */
-void Config_Format(const struct Config* p, void func(void* state, const char* name, const char* value), void* state);
+void Config_Format(const struct Config* p, Boolean includeHostOnly, void func(void* state, const char* name, const char* value), void* state);
 
 #endif
@@ -0,0 +1,312 @@
+/**
+  *  \file daemon.c
+  *  \brief Agave Tequilana - Daemon Mode
+  *
+  *  The PDK is not reentrant and keeps global state,
+  *  so each request is served in a fresh process.
+  *  To avoid paying for process creation while the host waits,
+  *  worker processes are created in advance and all wait in accept().
+  *
+  *  The daemon process itself never initializes the PDK, and reports errors directly to stderr.
+  */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "daemon.h"
+
+/** Maximum length of a request line. */
+#define MAX_REQUEST 1024
+
+static const char*const LOCK_FILE_NAME = "cactus.lck";
+
+/* Set by signal handler when the daemon shall stop */
+static volatile sig_atomic_t gStop;
+
+static void HandleStop(int sig)
+{
+    (void) sig;
+    gStop = 1;
+}
+
+/* Prepare a socket address. Returns false if the name is too long. */
+static Boolean InitAddress(struct sockaddr_un* pAddr, const char* socketName)
+{
+    memset(pAddr, 0, sizeof(*pAddr));
+    pAddr->sun_family = AF_UNIX;
+    if (strlen(socketName) >= sizeof(pAddr->sun_path)) {
+        fprintf(stderr, "%s: socket name too long\n", socketName);
+        return False;
+    }
+    strcpy(pAddr->sun_path, socketName);
+    return True;
+}
+
+/* Read request line from a connection. Returns false if none received. */
+static Boolean ReadRequest(int fd, char* buffer, size_t size)
+{
+    size_t n = 0;
+    while (n+1 < size) {
+        char ch;
+        ssize_t r = read(fd, &ch, 1);
+        if (r <= 0 || ch == '\n') {
+            break;
+        }
+        if (ch != '\r') {
+            buffer[n++] = ch;
+        }
+    }
+    buffer[n] = '\0';
+    return n != 0;
+}
+
+/* Worker process: serve one request, then exit. */
+static void RunWorker(int listenFd, void func(char* request, void* pData), void* pData)
+{
+    int fd;
+    do {
+        fd = accept(listenFd, 0, 0);
+    } while (fd < 0 && errno == EINTR);
+    if (fd < 0) {
+        exit(1);
+    }
+    close(listenFd);
+
+    // From now on, we may be modifying the game; do not let a shutdown interrupt that.
+    // The daemon waits for us to finish.
+    signal(SIGTERM, SIG_IGN);
+    signal(SIGINT, SIG_IGN);
+
+    char request[MAX_REQUEST];
+    if (!ReadRequest(fd, request, sizeof(request))) {
+        exit(1);
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+    dup2(fd, STDOUT_FILENO);
+    dup2(fd, STDERR_FILENO);
+    close(fd);
+
+    func(request, pData);
+    printf("%s\n", DAEMON_SUCCESS_MARKER);
+    exit(0);
+}
+
+/* Start a worker process. Returns its pid, or -1.
+   SIGTERM and SIGINT are blocked until the worker has reset the daemon's handlers;
+   otherwise, a worker stopped in that window would keep running and the daemon would wait for it forever. */
+static pid_t StartWorker(int listenFd, void func(char* request, void* pData), void* pData)
+{
+    sigset_t stopSignals, oldMask;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGTERM);
+    sigaddset(&stopSignals, SIGINT);
+
+    fflush(stdout);
+    fflush(stderr);
+    sigprocmask(SIG_BLOCK, &stopSignals, &oldMask);
+    pid_t pid = fork();
+    if (pid == 0) {
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGINT, SIG_DFL);
+        sigprocmask(SIG_SETMASK, &oldMask, 0);
+        RunWorker(listenFd, func, pData);
+    }
+    sigprocmask(SIG_SETMASK, &oldMask, 0);
+    return pid;
+}
+
+
+/*
+ *  Public Interface
+ */
+
+Boolean Daemon_Run(const char* socketName, int numWorkers, void func(char* request, void* pData), void* pData)
+{
+    struct sockaddr_un addr;
+    if (!InitAddress(&addr, socketName)) {
+        return False;
+    }
+    if (numWorkers < 1) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        numWorkers = (n > 0 ? (int) n : 1);
+    }
+
+    // Replace a stale socket, but never anything else.
+    struct stat st;
+    if (lstat(socketName, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            fprintf(stderr, "%s: file exists and is not a socket\n", socketName);
+            return False;
+        }
+        unlink(socketName);
+    }
+
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        fprintf(stderr, "Unable to create socket\n");
+        return False;
+    }
+
+    // Requests are not authenticated, so only the daemon's user may connect.
+    mode_t oldMask = umask(077);
+    int bindResult = bind(listenFd, (struct sockaddr*) &addr, sizeof(addr));
+    umask(oldMask);
+    if (bindResult != 0 || listen(listenFd, 16) != 0) {
+        fprintf(stderr, "%s: unable to listen on socket\n", socketName);
+        close(listenFd);
+        return False;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = HandleStop;
+    sigaction(SIGTERM, &sa, 0);
+    sigaction(SIGINT, &sa, 0);
+
+    pid_t* workers = MemAlloc((size_t) numWorkers * sizeof(pid_t));
+    for (int i = 0; i < numWorkers; ++i) {
+        workers[i] = StartWorker(listenFd, func, pData);
+        if (workers[i] < 0) {
+            fprintf(stderr, "Unable to start worker process\n");
+        }
+    }
+    printf("Listening on %s with %d worker(s)\n", socketName, numWorkers);
+    fflush(stdout);
+
+    // Replace every worker that finishes, until told to stop.
+    while (!gStop) {
+        int status;
+        pid_t pid = wait(&status);
+        if (pid < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "Unable to wait for worker process\n");
+            break;
+        }
+        for (int i = 0; i < numWorkers; ++i) {
+            if (workers[i] == pid) {
+                workers[i] = StartWorker(listenFd, func, pData);
+                break;
+            }
+        }
+    }
+
+    // Shut down. This terminates idle workers; busy workers ignore the signal and finish their request.
+    for (int i = 0; i < numWorkers; ++i) {
+        if (workers[i] > 0) {
+            kill(workers[i], SIGTERM);
+        }
+    }
+    while (wait(0) > 0 || errno == EINTR) {
+        // Wait for all workers
+    }
+    close(listenFd);
+    unlink(socketName);
+    MemFree(workers);
+    return True;
+}
+
+Boolean Daemon_LockGame(const char* gameDirectory)
+{
+    char* name = MemAlloc(strlen(gameDirectory) + strlen(LOCK_FILE_NAME) + 2);
+    sprintf(name, "%s/%s", gameDirectory, LOCK_FILE_NAME);
+    int fd = open(name, O_RDWR | O_CREAT, 0600);
+    MemFree(name);
+    if (fd < 0) {
+        printf("%s: unable to create lock file\n", gameDirectory);
+        return False;
+    }
+
+    // Lock entire file. The descriptor is deliberately kept open; the lock is released when the process exits.
+    struct flock lock;
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    if (fcntl(fd, F_SETLK, &lock) != 0) {
+        printf("%s: game is being processed by another request, waiting\n", gameDirectory);
+        fflush(stdout);
+        while (fcntl(fd, F_SETLKW, &lock) != 0) {
+            if (errno != EINTR) {
+                printf("%s: unable to lock game\n", gameDirectory);
+                close(fd);
+                return False;
+            }
+        }
+    }
+    return True;
+}
+
+void Daemon_MakeAbsolutePath(char* buffer, size_t size, const char* path)
+{
+    char cwd[1024];
+    if (path[0] == '/' || getcwd(cwd, sizeof(cwd)) == 0) {
+        snprintf(buffer, size, "%s", path);
+    } else {
+        snprintf(buffer, size, "%s/%s", cwd, path);
+    }
+}
+
+Boolean Daemon_Request(const char* socketName, const char* request)
+{
+    struct sockaddr_un addr;
+    if (!InitAddress(&addr, socketName)) {
+        return False;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0) {
+        fprintf(stderr, "%s: unable to connect\n", socketName);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return False;
+    }
+
+    size_t requestLength = strlen(request);
+    if (write(fd, request, requestLength) != (ssize_t) requestLength || write(fd, "\n", 1) != 1) {
+        fprintf(stderr, "%s: unable to send request\n", socketName);
+        close(fd);
+        return False;
+    }
+
+    // Copy response to stdout, holding back the last line to check for the marker.
+    char line[MAX_REQUEST];
+    size_t lineLength = 0;
+    Boolean success = False;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+        for (ssize_t i = 0; i < n; ++i) {
+            line[lineLength++] = buffer[i];
+            if (buffer[i] == '\n' || lineLength == sizeof(line)-1) {
+                line[lineLength] = '\0';
+                success = (strcmp(line, DAEMON_SUCCESS_MARKER "\n") == 0);
+                if (!success) {
+                    fputs(line, stdout);
+                }
+                lineLength = 0;
+            }
+        }
+    }
+    if (lineLength != 0) {
+        line[lineLength] = '\0';
+        fputs(line, stdout);
+        success = False;
+    }
+    close(fd);
+    return success;
+}
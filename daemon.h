@@ -0,0 +1,58 @@
+/**
+  *  \file daemon.h
+  *  \brief Agave Tequilana - Daemon Mode
+  */
+#ifndef DAEMON_H_INCLUDED
+#define DAEMON_H_INCLUDED
+
+#include <phostpdk.h>
+
+/** Run as daemon.
+    Listens on a Unix socket for requests, each a single line of text.
+    Each request is served by a worker process that has been forked in advance;
+    it serves exactly one request and is then replaced by a new worker,
+    so that no state carries over from one request to the next.
+
+    The worker's standard output and error go to the client.
+    If @c func returns normally, the line DAEMON_SUCCESS_MARKER is sent at the end;
+    if the worker exits prematurely (ErrorExit), it is not.
+
+    Runs until terminated by SIGTERM or SIGINT.
+    Idle workers are terminated; workers serving a request are allowed to finish.
+
+    The socket is only accessible to the daemon's user.
+
+    @param [in] socketName  Name of socket; an existing socket of that name is replaced, any other file is an error
+    @param [in] numWorkers  Number of worker processes to keep ready; 0 for default (number of processors)
+    @param [in] func        Function to serve a request; called in a worker process with the request line (without newline)
+    @param [in] pData       Opaque parameter for func
+    @return false on error during startup */
+Boolean Daemon_Run(const char* socketName, int numWorkers, void func(char* request, void* pData), void* pData);
+
+/** Lock a game for exclusive processing.
+    Takes a lock on the file `cactus.lck` in the game directory, waiting if another process holds it,
+    so that two requests for the same game are processed one after the other.
+    The lock is held until the calling process exits.
+    @param [in] gameDirectory  Game directory
+    @return true on success */
+Boolean Daemon_LockGame(const char* gameDirectory);
+
+/** Make a path absolute.
+    The daemon has its own working directory, so paths in requests must not be relative to the client's.
+    @param [out] buffer  Result
+    @param [in]  size    Size of buffer
+    @param [in]  path    Path, relative to the current directory or absolute */
+void Daemon_MakeAbsolutePath(char* buffer, size_t size, const char* path);
+
+/** Send a request to a daemon.
+    Sends the request, and copies the response to stdout.
+
+    @param [in] socketName  Name of socket
+    @param [in] request     Request (single line, without newline)
+    @return true if the request succeeded (response ended with DAEMON_SUCCESS_MARKER) */
+Boolean Daemon_Request(const char* socketName, const char* request);
+
+/** Marker for successful completion of a request. */
+#define DAEMON_SUCCESS_MARKER "cactus: done"
+
+#endif
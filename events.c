@@ -0,0 +1,157 @@
+/**
+  *  \file events.c
+  *  \brief Agave Tequilana - Event Stream
+  */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "events.h"
+#include "log.h"
+#include "stats.h"
+#include "util.h"
+
+static const char*const EVENT_FILE_NAME = "cactus.events";
+static const char*const EVENT_INDEX_FILE_NAME = "cactus.evi";
+static const char EVENT_FILE_MAGIC[8] = { 'C', 'A', 'C', 'T', 'E', 'V', 'T', '1' };
+
+/* Events collected so far, already in file format */
+static char* gEvents;
+static size_t gNumEvents;
+static size_t gCapacity;
+
+/* Format an event record. Values that do not fit into a signed word are clamped. */
+static void PutEvent(char* p, enum EventType type, RaceType_Def player, Uns16 planetId, int value)
+{
+    if (value > 32767) {
+        value = 32767;
+    }
+    if (value < -32768) {
+        value = -32768;
+    }
+    p[0] = (char) type;
+    p[1] = (char) player;
+    PutWord(p + 2, planetId);
+    PutWord(p + 4, (Uns16) value);
+}
+
+/* Open event file for update, creating it if needed.
+   Returns file with position at end, and its size. */
+static FILE* OpenEventFile(Uns32* pSize)
+{
+    char* name = MemAlloc(strlen(gGameDirectory) + strlen(EVENT_FILE_NAME) + 2);
+    sprintf(name, "%s/%s", gGameDirectory, EVENT_FILE_NAME);
+
+    FILE* fp = fopen(name, "r+b");
+    if (fp != 0) {
+        char magic[sizeof(EVENT_FILE_MAGIC)];
+        if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic) || memcmp(magic, EVENT_FILE_MAGIC, sizeof(magic)) != 0) {
+            LOG_WARNING("File %s is invalid, replacing it", EVENT_FILE_NAME);
+            fclose(fp);
+            fp = 0;
+        }
+    }
+    if (fp == 0) {
+        fp = fopen(name, "w+b");
+        if (fp != 0) {
+            fwrite(EVENT_FILE_MAGIC, 1, sizeof(EVENT_FILE_MAGIC), fp);
+        }
+    }
+    MemFree(name);
+
+    if (fp != 0) {
+        fseek(fp, 0, SEEK_END);
+        *pSize = (Uns32) ftell(fp);
+    }
+    return fp;
+}
+
+
+/*
+ *  Public Interface
+ */
+
+void Events_Add(enum EventType type, RaceType_Def player, Uns16 planetId, int value)
+{
+    if (gNumEvents >= gCapacity) {
+        gCapacity = 2*gCapacity + 100;
+        gEvents = MemRealloc(gEvents, gCapacity * EVENT_RECORD_SIZE);
+    }
+    PutEvent(gEvents + gNumEvents * EVENT_RECORD_SIZE, type, player, planetId, value);
+    ++gNumEvents;
+}
+
+void Events_Save(void)
+{
+    const Uns16 turn = TurnNumber();
+    if (turn == 0) {
+        return;
+    }
+
+    Uns32 fileSize;
+    FILE* fp = OpenEventFile(&fileSize);
+    if (fp == 0) {
+        LOG_WARNING("Unable to write %s", EVENT_FILE_NAME);
+        return;
+    }
+
+    // Load index. Entries are zero for turns that have not been processed.
+    size_t indexSize;
+    char* oldIndex = ReadWholeFile(EVENT_INDEX_FILE_NAME, GAME_DIR_ONLY, &indexSize);
+    const size_t numOldEntries = (oldIndex != 0 ? indexSize / EVENT_INDEX_SIZE : 0);
+
+    // If this turn or later ones have been processed before, drop their events.
+    Uns32 pos = fileSize;
+    for (size_t i = turn-1; i < numOldEntries; ++i) {
+        const Uns32 entryPos = GetLong(oldIndex + i*EVENT_INDEX_SIZE);
+        if (entryPos >= sizeof(EVENT_FILE_MAGIC) + EVENT_RECORD_SIZE && entryPos - EVENT_RECORD_SIZE < pos) {
+            pos = entryPos - EVENT_RECORD_SIZE;
+        }
+    }
+    if (pos != fileSize) {
+        fflush(fp);
+        if (ftruncate(fileno(fp), pos) != 0) {
+            LOG_WARNING("Unable to truncate %s", EVENT_FILE_NAME);
+        }
+        fseek(fp, (long) pos, SEEK_SET);
+    }
+
+    // Write events
+    char marker[EVENT_RECORD_SIZE];
+    PutEvent(marker, Event_Turn, 0, turn, 0);
+    fwrite(marker, 1, sizeof(marker), fp);
+    if (gNumEvents != 0) {
+        fwrite(gEvents, EVENT_RECORD_SIZE, gNumEvents, fp);
+    }
+    Stats_Add(Stat_BytesWritten, (Uns32) ((gNumEvents + 1) * EVENT_RECORD_SIZE));
+    if (ferror(fp) != 0 || fclose(fp) != 0) {
+        LOG_WARNING("Unable to write %s", EVENT_FILE_NAME);
+    }
+
+    // Write index
+    char* newIndex = MemAlloc((size_t) turn * EVENT_INDEX_SIZE);
+    memset(newIndex, 0, (size_t) turn * EVENT_INDEX_SIZE);
+    if (oldIndex != 0) {
+        memcpy(newIndex, oldIndex, MIN(numOldEntries, (size_t) turn-1) * EVENT_INDEX_SIZE);
+        MemFree(oldIndex);
+    }
+    PutLong(newIndex + (turn-1)*EVENT_INDEX_SIZE, pos + EVENT_RECORD_SIZE);
+    PutLong(newIndex + (turn-1)*EVENT_INDEX_SIZE + 4, (Uns32) gNumEvents);
+
+    FILE* indexFile = OpenOutputFile(EVENT_INDEX_FILE_NAME, GAME_DIR_ONLY | NO_MISSING_ERROR);
+    if (indexFile == 0 || fwrite(newIndex, EVENT_INDEX_SIZE, turn, indexFile) != turn) {
+        LOG_WARNING("Unable to write %s", EVENT_INDEX_FILE_NAME);
+    }
+    if (indexFile != 0) {
+        Stats_AddFile(indexFile);
+        fclose(indexFile);
+    }
+    MemFree(newIndex);
+
+    MemFree(gEvents);
+    gEvents = 0;
+    gNumEvents = 0;
+    gCapacity = 0;
+}
@@ -0,0 +1,68 @@
+/**
+  *  \file events.h
+  *  \brief Agave Tequilana - Event Stream
+  *
+  *  Game events are collected during a host run and appended to file `cactus.events`,
+  *  with an index by turn in `cactus.evi`.
+  *
+  *  `cactus.events` starts with the 8-byte signature "CACTEVT1",
+  *  followed by records of EVENT_RECORD_SIZE bytes each (all words little-endian):
+  *  - byte 0: type (enum EventType)
+  *  - byte 1: player
+  *  - word 2: planet Id
+  *  - word 4: value (signed; clamped to -32768..32767)
+  *
+  *  Each turn's events start with an Event_Turn record.
+  *
+  *  `cactus.evi` contains EVENT_INDEX_SIZE bytes per turn, starting with turn 1:
+  *  - long 0: file position of the first event after the Event_Turn record
+  *  - long 4: number of events after the Event_Turn record
+  *  Both are zero for turns that have not been processed.
+  *
+  *  Running a turn again replaces its events, and drops all events for later turns.
+  */
+#ifndef EVENTS_H_INCLUDED
+#define EVENTS_H_INCLUDED
+
+#include <phostpdk.h>
+
+/** Size of an event record. */
+#define EVENT_RECORD_SIZE 6
+
+/** Size of an index entry. */
+#define EVENT_INDEX_SIZE 8
+
+/** Event type.
+    These values are stored in the file; do not renumber. */
+enum EventType {
+    Event_Turn = 1,                     ///< Start of turn. planet=turn number.
+    Event_Built = 2,                    ///< Cactus built. player=builder, planet, value=cost.
+    Event_BuildFailed = 3,              ///< Build failed. player=requester, planet, value=reason (enum BuildResult).
+    Event_Captured = 4,                 ///< Cactus captured. player=new owner, planet, value=previous owner.
+    Event_Lost = 5,                     ///< Cactus lost (planet unowned). player=previous owner, planet.
+    Event_Stump = 6,                    ///< Stump created. player=builder, planet, value=new owner.
+    Event_VoteCast = 7,                 ///< Vote counted. player, value=number of votes.
+    Event_VoteIgnored = 8,              ///< Vote ignored. player, value=reason (enum VoteIgnoreReason).
+    Event_Finished = 9                  ///< Game finished. player=player with best score, value=score.
+};
+
+/** Reason for Event_VoteIgnored. */
+enum VoteIgnoreReason {
+    VoteIgnored_Turn = 1,               ///< VoteTurn not reached.
+    VoteIgnored_Build = 2               ///< Player built a cactus this turn.
+};
+
+/** Add an event.
+    Events are kept in memory until Events_Save().
+    @param [in] type      Type
+    @param [in] player    Player
+    @param [in] planetId  Planet Id, 0 if none
+    @param [in] value     Value, depending on type */
+void Events_Add(enum EventType type, RaceType_Def player, Uns16 planetId, int value);
+
+/** Save events.
+    Appends all events added so far as events for the current turn, and updates the index.
+    @pre PDK initialized (gGameDirectory set) */
+void Events_Save(void);
+
+#endif
@@ -3,18 +3,443 @@
   *  \brief Agave Tequilana - Language
   */
 
+#include <stddef.h>
+#include <string.h>
 #include "language.h"
+#include "log.h"
+#include "util.h"
 
 #include "lang_en.inc"
 #include "lang_de.inc"
 
+/*
+ *  Message Catalogs
+ *
+ *  A binary message catalog has the following layout:
+ *
+ *     8 BYTEs   Magic, "CACTLNG1"
+ *       DWORD   Number of strings, N
+ *     N DWORDs  Position of each string, relative to start of file
+ *               Strings, each null-terminated
+ *
+ *  All values are little-endian. Strings are used in-place.
+ *  A catalog can contain fewer strings than we know; missing strings are taken from the built-in language.
+ *
+ *  The text form has one `Name = "text"` line per string, optionally followed by `"text"` continuation lines.
+ *  Texts use C escapes (\n, \t, \\, \").
+ */
+
+static const char CATALOG_MAGIC[8] = { 'C', 'A', 'C', 'T', 'L', 'N', 'G', '1' };
+static const char*const CATALOG_FILE_NAME = "cactus%d.lng";
+
+/** Size of catalog header (magic and count).
+    @private */
+#define CATALOG_HEADER_SIZE 12
+
+/** Message catalog field definition.
+    @private */
+struct Field {
+    const char* Name;
+    size_t      Offset;
+};
+
+/** Define message catalog field.
+    @private */
+#define FIELD(x) { #x, offsetof(struct Language, x) }
+
+/* Message catalog fields, in catalog order.
+   Add new fields only at the end, so existing catalogs remain valid. */
+static const struct Field LANGUAGE_FIELDS[] = {
+    FIELD(Message_CommandSyntaxError_Top),
+    FIELD(Message_CommandSyntaxError_Bottom),
+    FIELD(Message_ScoreReport),
+    FIELD(Message_InventoryReport_Header),
+    FIELD(Message_InventoryReport_Continuation),
+    FIELD(Message_InventoryChanges_Header),
+    FIELD(Message_InventoryChanges_Continuation),
+    FIELD(ReportScores_Header),
+    FIELD(ReportScores_Footer),
+    FIELD(Message_CactusCaptured_Previous),
+    FIELD(Message_CactusCaptured_Current),
+    FIELD(Message_CactusLost),
+    FIELD(Message_CactusBuilt),
+    FIELD(Message_CactusFailed_NotOwned),
+    FIELD(Message_CactusFailed_HasFullCactus),
+    FIELD(Message_CactusFailed_CannotRebuild),
+    FIELD(Message_CactusFailed_NeedBase),
+    FIELD(Message_CactusFailed_ClansRequired),
+    FIELD(Message_CactusFailed_CactusLimit),
+    FIELD(Message_CactusFailed_MinScore),
+    FIELD(Message_VoteIgnored_Turn),
+    FIELD(Message_VoteIgnored_Build),
+    FIELD(SendConfig_Header),
+    FIELD(SendConfig_Continuation),
+    FIELD(Continuation),
+    FIELD(Score_NumOwnedCactuses),
+    FIELD(Score_NumBuiltCactuses),
+    FIELD(Score_Score),
+    FIELD(Message_InventoryReport_Legend),
+    FIELD(Message_CommandSummary_Header),
+    FIELD(Message_CommandSummary_Errors),
+    FIELD(Message_CommandSummary_Dropped),
+    FIELD(Message_CommandSummary_Skipped),
+};
+
+/** Number of message catalog fields.
+    @private */
+#define NUM_FIELDS (sizeof(LANGUAGE_FIELDS)/sizeof(LANGUAGE_FIELDS[0]))
+
+/** Loaded message catalog.
+    @private */
+struct Catalog {
+    struct Language Lang;               ///< Strings; point into Data.
+    char* Data;                         ///< File content.
+};
+
+/* Per-player languages, determined by Language_Load(). Index is player number. */
+static const struct Language* gPlayerLanguage[RACE_NR+1];
+
+/* Catalogs loaded by Language_Load(). */
+static struct Catalog* gCatalogs[RACE_NR];
+static size_t gNumCatalogs;
+
+
+/*
+ *  Internal
+ */
+
+static const char** FieldPointer(struct Language* p, size_t index)
+{
+    return (const char**) ((char*) p + LANGUAGE_FIELDS[index].Offset);
+}
+
+static const char* FieldValue(const struct Language* p, size_t index)
+{
+    return *(const char*const*) ((const char*) p + LANGUAGE_FIELDS[index].Offset);
+}
+
+static const struct Language* GetBuiltinLanguage(Language_Def lang)
+{
+    if (lang == LANG_German) {
+        return &GERMAN;
+    }
+    return &ENGLISH;
+}
+
+/* Check that a message template does not end in an incomplete placeholder ("%" or "%12"). */
+static Boolean IsValidTemplate(const char* p)
+{
+    while ((p = strchr(p, '%')) != 0) {
+        ++p;
+        p += strspn(p, "0123456789");
+        if (*p == '\0') {
+            return False;
+        }
+        ++p;
+    }
+    return True;
+}
+
+/* Verify a binary catalog and populate a Language structure from it.
+   Strings not contained in the catalog are taken from pDefault. */
+static Boolean ParseCatalog(const char* data, size_t size, struct Language* pLang, const struct Language* pDefault)
+{
+    *pLang = *pDefault;
+
+    if (size <= CATALOG_HEADER_SIZE || memcmp(data, CATALOG_MAGIC, sizeof(CATALOG_MAGIC)) != 0) {
+        return False;
+    }
+
+    // Last byte must be a terminator; this guarantees that every string is terminated.
+    const Uns32 numStrings = GetLong(data + sizeof(CATALOG_MAGIC));
+    if (numStrings > (size - CATALOG_HEADER_SIZE) / 4 || data[size-1] != '\0') {
+        return False;
+    }
+
+    const Uns32 stringStart = CATALOG_HEADER_SIZE + 4*numStrings;
+    for (Uns32 i = 0; i < numStrings; ++i) {
+        const Uns32 pos = GetLong(data + CATALOG_HEADER_SIZE + 4*i);
+        if (pos < stringStart || pos >= size) {
+            return False;
+        }
+        if (i < NUM_FIELDS) {
+            if (!IsValidTemplate(data + pos)) {
+                return False;
+            }
+            *FieldPointer(pLang, i) = data + pos;
+        }
+    }
+    return True;
+}
+
+/* Load catalog for a language. Returns null if there is none. */
+static struct Catalog* LoadCatalog(Language_Def lang)
+{
+    char fileName[30];
+    sprintf(fileName, CATALOG_FILE_NAME, (int) lang);
+
+    size_t size;
+    char* data = ReadWholeFile(fileName, GAME_OR_ROOT_DIR, &size);
+    if (data == 0) {
+        return 0;
+    }
+
+    struct Catalog* p = MemAlloc(sizeof(struct Catalog));
+    p->Data = data;
+    if (!ParseCatalog(data, size, &p->Lang, GetBuiltinLanguage(lang))) {
+        MemFree(data);
+        MemFree(p);
+        p = 0;
+    }
+
+    if (p != 0) {
+        LOG_INFO("Loaded message catalog %s", fileName);
+    } else {
+        LOG_WARNING("Message catalog %s is invalid, ignoring", fileName);
+    }
+    return p;
+}
+
+/** Growable character buffer.
+    @private */
+struct Buffer {
+    char* Data;
+    size_t Size;
+    size_t Capacity;
+};
+
+static void Buffer_Append(struct Buffer* b, char ch)
+{
+    if (b->Size >= b->Capacity) {
+        b->Capacity = 2*b->Capacity + 1000;
+        b->Data = MemRealloc(b->Data, b->Capacity);
+    }
+    b->Data[b->Size++] = ch;
+}
+
+/* Parse a quoted string starting at p, appending it to the buffer.
+   Returns pointer after closing quote, or null on syntax error. */
+static const char* ParseQuotedString(const char* p, struct Buffer* b)
+{
+    if (*p++ != '"') {
+        return 0;
+    }
+    while (*p != '"') {
+        char ch = *p++;
+        if (ch == '\0') {
+            return 0;
+        }
+        if (ch == '\\') {
+            switch (*p++) {
+             case 'n':  ch = '\n'; break;
+             case 't':  ch = '\t'; break;
+             case '\\': ch = '\\'; break;
+             case '"':  ch = '"';  break;
+             default:   return 0;
+            }
+        }
+        Buffer_Append(b, ch);
+    }
+    return p+1;
+}
+
+static const char* SkipSpace(const char* p)
+{
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') {
+        ++p;
+    }
+    return p;
+}
+
+/* Parse message catalog text. Produces null-terminated strings into the buffer, and their positions in the positions array.
+   Returns true on success; false on error (error has been logged). */
+static Boolean ParseCatalogText(FILE* fp, const char* fileName, struct Buffer* b, long (*pPositions)[NUM_FIELDS])
+{
+    char line[1000];
+    int lineNr = 0;
+    Boolean haveField = False;
+
+    for (size_t i = 0; i < NUM_FIELDS; ++i) {
+        (*pPositions)[i] = -1;
+    }
+
+    while (fgets(line, sizeof(line), fp) != 0) {
+        ++lineNr;
+        const char* p = SkipSpace(line);
+        if (*p == '\0' || *p == '#') {
+            // Blank or comment
+            continue;
+        }
+
+        if (*p != '"') {
+            // Start of new field: terminate previous
+            size_t nameLength = strcspn(p, " \t=");
+            size_t index = 0;
+            while (index < NUM_FIELDS
+                   && (strlen(LANGUAGE_FIELDS[index].Name) != nameLength
+                       || memcmp(LANGUAGE_FIELDS[index].Name, p, nameLength) != 0))
+            {
+                ++index;
+            }
+            if (index >= NUM_FIELDS) {
+                LOG_ERROR("%s:%d: unknown string name", fileName, lineNr);
+                return False;
+            }
+            if ((*pPositions)[index] >= 0) {
+                LOG_ERROR("%s:%d: duplicate string '%s'", fileName, lineNr, LANGUAGE_FIELDS[index].Name);
+                return False;
+            }
+            p = SkipSpace(p + nameLength);
+            if (*p++ != '=') {
+                LOG_ERROR("%s:%d: expected '='", fileName, lineNr);
+                return False;
+            }
+            p = SkipSpace(p);
+
+            if (haveField) {
+                Buffer_Append(b, '\0');
+            }
+            (*pPositions)[index] = (long) b->Size;
+            haveField = True;
+        } else if (!haveField) {
+            LOG_ERROR("%s:%d: expected string name", fileName, lineNr);
+            return False;
+        }
+
+        p = ParseQuotedString(p, b);
+        if (p == 0 || *SkipSpace(p) != '\0') {
+            LOG_ERROR("%s:%d: invalid string", fileName, lineNr);
+            return False;
+        }
+    }
+    if (haveField) {
+        Buffer_Append(b, '\0');
+    }
+
+    for (size_t i = 0; i < NUM_FIELDS; ++i) {
+        if ((*pPositions)[i] < 0) {
+            LOG_ERROR("%s: missing string '%s'", fileName, LANGUAGE_FIELDS[i].Name);
+            return False;
+        }
+        if (!IsValidTemplate(b->Data + (*pPositions)[i])) {
+            LOG_ERROR("%s: string '%s' ends in an incomplete placeholder", fileName, LANGUAGE_FIELDS[i].Name);
+            return False;
+        }
+    }
+    return True;
+}
+
+
+/*
+ *  Public Interface
+ */
+
 const struct Language* GetLanguageForPlayer(RaceType_Def player)
 {
     if (player > 0 && player <= RACE_NR) {
-        Language_Def lang = gPconfigInfo->Language[player];
-        if (lang == LANG_German) {
-            return &GERMAN;
+        if (gPlayerLanguage[player] != 0) {
+            return gPlayerLanguage[player];
         }
+        return GetBuiltinLanguage(gPconfigInfo->Language[player]);
     }
     return &ENGLISH;
 }
+
+void Language_Load(void)
+{
+    Language_Free();
+
+    for (int player = 1; player <= RACE_NR; ++player) {
+        const Language_Def lang = gPconfigInfo->Language[player];
+
+        // Same language as a previous player?
+        const struct Language* pLang = 0;
+        for (int other = 1; other < player && pLang == 0; ++other) {
+            if (gPconfigInfo->Language[other] == lang) {
+                pLang = gPlayerLanguage[other];
+            }
+        }
+
+        // Try to load a catalog
+        if (pLang == 0) {
+            struct Catalog* pCatalog = LoadCatalog(lang);
+            if (pCatalog != 0) {
+                gCatalogs[gNumCatalogs++] = pCatalog;
+                pLang = &pCatalog->Lang;
+            } else {
+                pLang = GetBuiltinLanguage(lang);
+            }
+        }
+        gPlayerLanguage[player] = pLang;
+    }
+}
+
+void Language_Free(void)
+{
+    for (size_t i = 0; i < gNumCatalogs; ++i) {
+        MemFree(gCatalogs[i]->Data);
+        MemFree(gCatalogs[i]);
+    }
+    gNumCatalogs = 0;
+    for (int player = 0; player <= RACE_NR; ++player) {
+        gPlayerLanguage[player] = 0;
+    }
+}
+
+Boolean Language_Compile(const char* sourceName, const char* targetName)
+{
+    FILE* in = fopen(sourceName, "r");
+    if (in == 0) {
+        LOG_ERROR("%s: unable to open file", sourceName);
+        return False;
+    }
+
+    struct Buffer strings = { 0, 0, 0 };
+    long positions[NUM_FIELDS];
+    Boolean ok = ParseCatalogText(in, sourceName, &strings, &positions);
+    fclose(in);
+
+    if (ok) {
+        char header[CATALOG_HEADER_SIZE + 4*NUM_FIELDS];
+        memcpy(header, CATALOG_MAGIC, sizeof(CATALOG_MAGIC));
+        PutLong(header + sizeof(CATALOG_MAGIC), NUM_FIELDS);
+        for (size_t i = 0; i < NUM_FIELDS; ++i) {
+            PutLong(header + CATALOG_HEADER_SIZE + 4*i, (Uns32) (sizeof(header) + positions[i]));
+        }
+
+        FILE* out = fopen(targetName, "wb");
+        ok = (out != 0
+              && fwrite(header, 1, sizeof(header), out) == sizeof(header)
+              && fwrite(strings.Data, 1, strings.Size, out) == strings.Size);
+        if (out != 0 && fclose(out) != 0) {
+            ok = False;
+        }
+        if (!ok) {
+            LOG_ERROR("%s: unable to write file", targetName);
+        }
+    }
+
+    MemFree(strings.Data);
+    return ok;
+}
+
+void Language_Dump(Language_Def lang, FILE* fp)
+{
+    const struct Language* pLang = GetBuiltinLanguage(lang);
+    for (size_t i = 0; i < NUM_FIELDS; ++i) {
+        // Write one quoted string per line of text
+        const char* p = FieldValue(pLang, i);
+        fprintf(fp, "%s = \"", LANGUAGE_FIELDS[i].Name);
+        while (*p != '\0') {
+            const char ch = *p++;
+            switch (ch) {
+             case '\n': fputs(*p != '\0' ? "\\n\"\n    \"" : "\\n", fp); break;
+             case '\t': fputs("\\t", fp);  break;
+             case '\\': fputs("\\\\", fp); break;
+             case '"':  fputs("\\\"", fp); break;
+             default:   fputc(ch, fp);     break;
+            }
+        }
+        fputs("\"\n\n", fp);
+    }
+}
@@ -6,6 +6,7 @@
 #define LANGUAGE_H_INCLUDED
 
 #include <phostpdk.h>
+#include <stdio.h>
 
 /** Definition for a single language.
     Each string is (part of) a message template. */
@@ -13,11 +14,18 @@ struct Language {
     // Error
     const char* Message_CommandSyntaxError_Top;            ///< "Command...."
     const char* Message_CommandSyntaxError_Bottom;         ///< "...had a syntax error."
+    const char* Message_CommandSummary_Header;             ///< "Some commands were not processed:"
+    const char* Message_CommandSummary_Errors;             ///< "N more errors."
+    const char* Message_CommandSummary_Dropped;            ///< "N commands over limit."
+    const char* Message_CommandSummary_Skipped;            ///< "N planets skipped in bulk builds."
 
     // Reports
     const char* Message_ScoreReport;                       ///< "Here's your score report:".
     const char* Message_InventoryReport_Header;            ///< "Here's your inventory report:".
     const char* Message_InventoryReport_Continuation;      ///< "Continuation of your inventory report:".
+    const char* Message_InventoryChanges_Header;           ///< "Here are your inventory changes:".
+    const char* Message_InventoryChanges_Continuation;     ///< "Continuation of your inventory changes:".
+    const char* Message_InventoryReport_Legend;            ///< Explanation of type codes in compact inventory.
     const char* ReportScores_Header;                       ///< Header of score table.
     const char* ReportScores_Footer;                       ///< Footer off score table.
 
@@ -54,7 +62,31 @@ struct Language {
 
 /** Get language for a player.
     Will never return null; if player has no (recognized) language, returns English.
+    If Language_Load() has been called, returns the language determined there.
     \param player Player */
 const struct Language* GetLanguageForPlayer(RaceType_Def player);
 
+/** Load message catalogs.
+    Determines every player's language once.
+    If a message catalog file `cactusN.lng` (N = numeric value of player's `Language` setting)
+    exists in the game or root directory, it is loaded and replaces the built-in language.
+    @pre PDK initialized, host data loaded */
+void Language_Load(void);
+
+/** Discard message catalogs loaded by Language_Load().
+    Afterwards, GetLanguageForPlayer() reverts to the built-in languages. */
+void Language_Free(void);
+
+/** Compile a message catalog.
+    Reads a message catalog in text form (as produced by Language_Dump()) and writes it in binary form.
+    @param [in] sourceName  Name of text file
+    @param [in] targetName  Name of binary file
+    @return true on success; false on error (error has been logged) */
+Boolean Language_Compile(const char* sourceName, const char* targetName);
+
+/** Dump a built-in language as message catalog in text form.
+    @param [in] lang  Language, as in PHost's `Language` setting
+    @param [out] fp   Output file */
+void Language_Dump(Language_Def lang, FILE* fp);
+
 #endif
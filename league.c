@@ -0,0 +1,291 @@
+/**
+  *  \file league.c
+  *  \brief Agave Tequilana - League Standings
+  *
+  *  Each game's state is a small file (cactus.hst) that is read in one go,
+  *  so games are simply processed one after the other.
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "league.h"
+#include "state.h"
+
+/** Maximum number of ranks that receive league points.
+    @private */
+#define MAX_RANK_POINTS 20
+
+/** Maximum length of a participant name.
+    @private */
+#define MAX_NAME 40
+
+/** Standing of one participant in the league.
+    @private */
+struct Standing {
+    char Name[MAX_NAME];                ///< Participant name.
+    long Points;                        ///< League points.
+    long Score;                         ///< Sum of game scores.
+    int NumGames;                       ///< Number of games.
+    int NumWins;                        ///< Number of games ranked first.
+};
+
+/** One participant in a game.
+    @private */
+struct Participant {
+    const char* Name;                   ///< Participant name.
+    RaceType_Def Player;                ///< Player slot in game.
+    int Score;                          ///< Game score.
+};
+
+/** League.
+    @private */
+struct League {
+    int Points[MAX_RANK_POINTS];        ///< League points per rank.
+    int NumPoints;                      ///< Number of elements in Points.
+    int ScoreDivisor;                   ///< Game points per additional league point; 0 if none.
+    char* OutputFileName;               ///< Output file name; null for stdout.
+    int NumGames;                       ///< Number of games processed.
+    struct Standing* Standings;         ///< Standings.
+    size_t NumStandings;                ///< Number of elements in Standings.
+    size_t Capacity;                    ///< Allocated elements in Standings.
+};
+
+/* Parse a non-negative number (at most 32767). Returns false if the text is not such a number. */
+static Boolean ParseNumber(const char* text, int* pResult)
+{
+    char* end;
+    long value = strtol(text, &end, 10);
+    if (*text < '0' || *text > '9' || *end != '\0' || value > 32767) {
+        return False;
+    }
+    *pResult = (int) value;
+    return True;
+}
+
+/* Find or create a participant's standing. */
+static struct Standing* GetStanding(struct League* pLeague, const char* name)
+{
+    for (size_t i = 0; i < pLeague->NumStandings; ++i) {
+        if (strcmp(pLeague->Standings[i].Name, name) == 0) {
+            return &pLeague->Standings[i];
+        }
+    }
+    if (pLeague->NumStandings >= pLeague->Capacity) {
+        pLeague->Capacity = 2*pLeague->Capacity + 16;
+        pLeague->Standings = MemRealloc(pLeague->Standings, pLeague->Capacity * sizeof(struct Standing));
+    }
+    struct Standing* p = &pLeague->Standings[pLeague->NumStandings++];
+    memset(p, 0, sizeof(*p));
+    strncpy(p->Name, name, sizeof(p->Name) - 1);
+    return p;
+}
+
+/* Award league points for one game. */
+static void ScoreGame(struct League* pLeague, const struct Participant* parts, size_t numParts)
+{
+    for (size_t i = 0; i < numParts; ++i) {
+        // Rank is 1 + number of participants with a better score
+        int rank = 1;
+        for (size_t j = 0; j < numParts; ++j) {
+            if (parts[j].Score > parts[i].Score) {
+                ++rank;
+            }
+        }
+
+        struct Standing* p = GetStanding(pLeague, parts[i].Name);
+        p->Points += (rank <= pLeague->NumPoints ? pLeague->Points[rank-1] : 0);
+        if (pLeague->ScoreDivisor > 0) {
+            p->Points += parts[i].Score / pLeague->ScoreDivisor;
+        }
+        p->Score += parts[i].Score;
+        p->NumGames += 1;
+        p->NumWins += (rank == 1);
+    }
+}
+
+/* Process a "game" line: directory, followed by participants. Returns false on error. */
+static Boolean ProcessGame(struct League* pLeague, char* args)
+{
+    const char* dirName = strtok(args, " \t");
+    if (dirName == 0) {
+        return False;
+    }
+
+    struct Participant parts[RACE_NR];
+    char names[RACE_NR][MAX_NAME];
+    size_t numParts = 0;
+    char* tok;
+    while ((tok = strtok(0, " \t")) != 0) {
+        char* eq = strchr(tok, '=');
+        int player = (eq != 0 ? atoi(eq+1) : 0);
+        if (eq == 0 || eq == tok || player <= 0 || player > RACE_NR || numParts >= RACE_NR) {
+            return False;
+        }
+        *eq = '\0';
+        parts[numParts].Name = tok;
+        parts[numParts].Player = (RaceType_Def) player;
+        ++numParts;
+    }
+
+    // dirName points into the caller's line buffer, so only keep it for the duration of State_Load().
+    const char* prevGameDirectory = gGameDirectory;
+    gGameDirectory = dirName;
+    struct State* pState = State_Create();
+    State_Load(pState, False);
+    gGameDirectory = prevGameDirectory;
+    Boolean ok = (State_PreviousTurn(pState) != 0);
+    if (!ok) {
+        // Do not silently produce standings with a game missing.
+        fprintf(stderr, "%s: no game state\n", dirName);
+    } else {
+        if (numParts == 0) {
+            // Everyone who did anything
+            for (int i = 1; i <= RACE_NR; ++i) {
+                const RaceType_Def r = (RaceType_Def) i;
+                if (State_Score(pState, r) != 0 || State_NumBuiltCactuses(pState, r) != 0 || State_NumOwnedCactuses(pState, r) != 0) {
+                    sprintf(names[numParts], "player%d", i);
+                    parts[numParts].Name = names[numParts];
+                    parts[numParts].Player = r;
+                    ++numParts;
+                }
+            }
+        }
+        for (size_t i = 0; i < numParts; ++i) {
+            parts[i].Score = State_Score(pState, parts[i].Player);
+        }
+        ScoreGame(pLeague, parts, numParts);
+        ++pLeague->NumGames;
+    }
+    State_Destroy(pState);
+    return ok;
+}
+
+/* Process a "points" line. Returns false on syntax error. */
+static Boolean ProcessPoints(struct League* pLeague, char* args)
+{
+    char* tok;
+    pLeague->NumPoints = 0;
+    for (tok = strtok(args, " \t"); tok != 0; tok = strtok(0, " \t")) {
+        if (pLeague->NumPoints >= MAX_RANK_POINTS || !ParseNumber(tok, &pLeague->Points[pLeague->NumPoints])) {
+            return False;
+        }
+        ++pLeague->NumPoints;
+    }
+    return True;
+}
+
+/* Read and process the specification. */
+static Boolean ReadSpec(const char* fileName, struct League* pLeague)
+{
+    FILE* fp = fopen(fileName, "r");
+    if (fp == 0) {
+        fprintf(stderr, "%s: unable to open file\n", fileName);
+        return False;
+    }
+
+    char line[1024];
+    int lineNr = 0;
+    Boolean ok = True;
+    while (ok && fgets(line, sizeof(line), fp) != 0) {
+        ++lineNr;
+        line[strcspn(line, "\r\n")] = '\0';
+        char* p = line + strspn(line, " \t");
+        if (*p == '\0' || *p == '#') {
+            continue;
+        }
+
+        size_t keywordLength = strcspn(p, " \t");
+        char* args = p + keywordLength;
+        if (*args != '\0') {
+            *args++ = '\0';
+            args += strspn(args, " \t");
+        }
+
+        if (strcmp(p, "game") == 0) {
+            ok = ProcessGame(pLeague, args);
+        } else if (strcmp(p, "points") == 0) {
+            ok = ProcessPoints(pLeague, args);
+        } else if (strcmp(p, "score-divisor") == 0) {
+            ok = ParseNumber(args, &pLeague->ScoreDivisor);
+        } else if (strcmp(p, "output") == 0 && *args != '\0') {
+            MemFree(pLeague->OutputFileName);
+            pLeague->OutputFileName = MemAlloc(strlen(args) + 1);
+            strcpy(pLeague->OutputFileName, args);
+        } else {
+            ok = False;
+        }
+        if (!ok) {
+            fprintf(stderr, "%s:%d: invalid line\n", fileName, lineNr);
+        }
+    }
+    fclose(fp);
+    return ok;
+}
+
+/* Sort standings, best first. */
+static int CompareStandings(const void* a, const void* b)
+{
+    const struct Standing* sa = a;
+    const struct Standing* sb = b;
+    if (sa->Points != sb->Points) {
+        return sa->Points > sb->Points ? -1 : 1;
+    }
+    if (sa->Score != sb->Score) {
+        return sa->Score > sb->Score ? -1 : 1;
+    }
+    return strcmp(sa->Name, sb->Name);
+}
+
+/* Write standings. */
+static Boolean WriteStandings(struct League* pLeague)
+{
+    FILE* fp = (pLeague->OutputFileName != 0 ? fopen(pLeague->OutputFileName, "w") : stdout);
+    if (fp == 0) {
+        fprintf(stderr, "%s: unable to create file\n", pLeague->OutputFileName);
+        return False;
+    }
+
+    qsort(pLeague->Standings, pLeague->NumStandings, sizeof(struct Standing), CompareStandings);
+    fprintf(fp, "League standings after %d game(s)\n\n", pLeague->NumGames);
+    fprintf(fp, "Rank  Points  Games  Wins    Score  Player\n");
+    for (size_t i = 0; i < pLeague->NumStandings; ++i) {
+        const struct Standing* p = &pLeague->Standings[i];
+        size_t rank = i;
+        while (rank > 0 && pLeague->Standings[rank-1].Points == p->Points) {
+            --rank;
+        }
+        fprintf(fp, "%4d  %6ld  %5d  %4d  %7ld  %s\n",
+                (int) rank+1, p->Points, p->NumGames, p->NumWins, p->Score, p->Name);
+    }
+
+    Boolean ok = (ferror(fp) == 0);
+    if (fp != stdout && fclose(fp) != 0) {
+        ok = False;
+    }
+    if (!ok) {
+        fprintf(stderr, "Unable to write standings\n");
+    }
+    return ok;
+}
+
+
+/*
+ *  Public Interface
+ */
+
+Boolean League_Run(const char* specFileName)
+{
+    static const int DEFAULT_POINTS[] = { 10, 6, 4, 3, 2, 1 };
+
+    struct League league;
+    memset(&league, 0, sizeof(league));
+    league.NumPoints = (int) (sizeof(DEFAULT_POINTS) / sizeof(DEFAULT_POINTS[0]));
+    memcpy(league.Points, DEFAULT_POINTS, sizeof(DEFAULT_POINTS));
+
+    Boolean ok = ReadSpec(specFileName, &league) && WriteStandings(&league);
+
+    MemFree(league.Standings);
+    MemFree(league.OutputFileName);
+    return ok;
+}
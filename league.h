@@ -0,0 +1,30 @@
+/**
+  *  \file league.h
+  *  \brief Agave Tequilana - League Standings
+  */
+#ifndef LEAGUE_H_INCLUDED
+#define LEAGUE_H_INCLUDED
+
+#include <phostpdk.h>
+
+/** Compute league standings.
+    Reads a league specification, loads the state of every game it lists,
+    awards league points for each game, and writes the consolidated standings.
+
+    The specification is a text file; empty lines and lines starting with '#' are ignored.
+    - `points N1 N2 ...`: league points for rank 1, 2, ... in a game (default: 10 6 4 3 2 1)
+    - `score-divisor N`: additionally award one league point per N game points (default: 0=none)
+    - `output FILE`: write standings to FILE instead of stdout
+    - `game DIR [NAME=PLAYER ...]`: a game and its participants.
+      If no participants are given, every player slot with a score or cactus takes part as "playerN".
+
+    Players with the same score share a rank.
+    Point values must be non-negative numbers. A game without state file is an error.
+
+    This only reads the state files (cactus.hst) and does not initialize the PDK.
+
+    @param [in] specFileName  Name of league specification
+    @return true on success */
+Boolean League_Run(const char* specFileName);
+
+#endif
@@ -0,0 +1,68 @@
+/**
+  *  \file log.c
+  *  \brief Agave Tequilana - Logging
+  */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "log.h"
+
+/** Size of log buffer.
+    @private */
+#define LOG_BUFFER_SIZE 16384
+
+/** Maximum length of a single log message.
+    @private */
+#define LOG_LINE_SIZE 1024
+
+static char gBuffer[LOG_BUFFER_SIZE];
+static size_t gLength;
+static int gLevel = LOG_LEVEL_INFO;
+
+
+/*
+ *  Public Interface
+ */
+
+void Log_SetLevel(int level)
+{
+    gLevel = level;
+}
+
+void Log_Write(int level, const char* fmt, ...)
+{
+    if (level > gLevel) {
+        return;
+    }
+
+    char line[LOG_LINE_SIZE];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(line, sizeof(line)-1, fmt, args);
+    va_end(args);
+    if (n < 0) {
+        return;
+    }
+
+    size_t length = (size_t) n < sizeof(line)-1 ? (size_t) n : sizeof(line)-2;
+    line[length++] = '\n';
+    if (gLength + length > sizeof(gBuffer)) {
+        Log_Flush();
+    }
+    memcpy(gBuffer + gLength, line, length);
+    gLength += length;
+}
+
+void Log_Flush(void)
+{
+    if (gLength != 0) {
+        fwrite(gBuffer, 1, gLength, stdout);
+        fflush(stdout);
+        if (gLogFile != 0) {
+            fwrite(gBuffer, 1, gLength, gLogFile);
+            fflush(gLogFile);
+        }
+        gLength = 0;
+    }
+}
@@ -0,0 +1,73 @@
+/**
+  *  \file log.h
+  *  \brief Agave Tequilana - Logging
+  *
+  *  Log messages are formatted into a buffer and written to stdout and the log file (gLogFile)
+  *  when the buffer fills up, at phase boundaries (Stats_Phase), and when Log_Flush() is called.
+  *
+  *  Messages have a level; messages above the level configured at runtime (Log_SetLevel) are discarded.
+  *  Messages above LOG_MAX_LEVEL are removed at compile time;
+  *  for example, build with `-DLOG_MAX_LEVEL=LOG_LEVEL_INFO` to remove all per-item detail logging.
+  *
+  *  Warnings and errors always go through the PDK's Warning() and Error(), after flushing the buffer to preserve ordering.
+  *  There is no flush at program exit, because the PDK may already have closed the log file by then;
+  *  every exit path must call Log_Flush() before FreePHOSTLib() or ErrorExit().
+  */
+#ifndef LOG_H_INCLUDED
+#define LOG_H_INCLUDED
+
+#include <phostpdk.h>
+
+/** Log level: only warnings and errors. */
+#define LOG_LEVEL_QUIET   0
+/** Log level: program phases. */
+#define LOG_LEVEL_PHASE   1
+/** Log level: actions taken, such as cactuses built and commands rejected (default). */
+#define LOG_LEVEL_INFO    2
+/** Log level: per-item details, such as captures and score changes. */
+#define LOG_LEVEL_DETAIL  3
+
+/** Maximum level compiled in. */
+#ifndef LOG_MAX_LEVEL
+# define LOG_MAX_LEVEL LOG_LEVEL_DETAIL
+#endif
+
+#if LOG_MAX_LEVEL >= LOG_LEVEL_PHASE
+# define LOG_PHASE(...)  Log_Write(LOG_LEVEL_PHASE, __VA_ARGS__)
+#else
+# define LOG_PHASE(...)  ((void) 0)
+#endif
+
+#if LOG_MAX_LEVEL >= LOG_LEVEL_INFO
+# define LOG_INFO(...)   Log_Write(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+# define LOG_INFO(...)   ((void) 0)
+#endif
+
+#if LOG_MAX_LEVEL >= LOG_LEVEL_DETAIL
+# define LOG_DETAIL(...) Log_Write(LOG_LEVEL_DETAIL, __VA_ARGS__)
+#else
+# define LOG_DETAIL(...) ((void) 0)
+#endif
+
+#define LOG_WARNING(...) (Log_Flush(), Warning(__VA_ARGS__))
+#define LOG_ERROR(...)   (Log_Flush(), Error(__VA_ARGS__))
+
+/** Set log level.
+    @param [in] level  Level (LOG_LEVEL_XXX); messages above this level are discarded */
+void Log_SetLevel(int level);
+
+/** Write log message.
+    Use the LOG_XXX macros instead of calling this directly.
+    @param [in] level  Level of message
+    @param [in] fmt    printf-style format string; a newline is appended */
+void Log_Write(int level, const char* fmt, ...)
+#ifdef __GNUC__
+    __attribute__((format(printf, 2, 3)))
+#endif
+    ;
+
+/** Flush buffered log messages. */
+void Log_Flush(void);
+
+#endif
@@ -11,67 +11,158 @@
 
 #include <phostpdk.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include "batch.h"
 #include "commands.h"
+#include "daemon.h"
+#include "events.h"
 #include "config.h"
+#include "language.h"
+#include "league.h"
+#include "log.h"
+#include "message.h"
+#include "metrics.h"
 #include "score.h"
+#include "scoreboard.h"
 #include "sendconf.h"
 #include "state.h"
+#include "stats.h"
 #include "version.h"
 
 static const char*const BANNER = "Agave Tequilana - A Tequila War Variant";
 static const char*const LOG_FILE = "cactus.log";
+static const char*const STATS_FILE = "cactus.stats";
+static const char*const PREPARE_STATS_FILE = "cactus1.stats";
+
+/* Log level given on command line; -1 to use configuration */
+static int gLogLevel = -1;
+
+/* Directory for metrics given on command line; null to use game directory */
+static const char* gMetricsDirectory = 0;
+
+/* Farm-wide scoreboard file given on command line; null if none */
+static const char* gScoreboardFile = 0;
 
 /** Mode of operation.
     @private */
 enum Mode {
     HostAction,
+    PrepareAction,
     DumpStatus,
+    DumpJSON,
+    DumpCSV,
+    Query,
     DumpConfig,
+    DumpLanguage,
+    CompileLanguage,
+    Ingest,
+    League,
     Help
 };
 
+/** How to run host actions.
+    @private */
+enum Driver {
+    Driver_Direct,                      ///< In this process.
+    Driver_Batch,                       ///< Batch mode, multiple games in parallel.
+    Driver_Daemon,                      ///< Daemon mode, serve requests.
+    Driver_Client                       ///< Client mode, send request to daemon.
+};
+
 static void PrintUsage(FILE* stream, const char* name)
 {
     fprintf(stream, "%s - v%s\n\n"
-            "Usage: %s [MODE] [GAMEDIR [ROOTDIR]]\n\n"
+            "Usage: %s [MODE] [GAMEDIR [ROOTDIR]]\n"
+            "       %s -dl [LANGUAGE] > FILE.txt\n"
+            "       %s -cl FILE.txt FILE.lng\n"
+            "       %s --ingest GAMEDIR PLAYER\n"
+            "       %s -q GAMEDIR QUERY [ARG]\n"
+            "       %s --league SPECFILE\n"
+            "       %s --batch LISTFILE [ROOTDIR] [-jN] [-vN] [--metrics DIR] [--scoreboard FILE] [-i] [-1|-2]\n"
+            "       %s --daemon SOCKET [-jN] [--metrics DIR] [--scoreboard FILE]\n"
+            "       %s --client SOCKET GAMEDIR [ROOTDIR] [-vN] [-i] [-1|-2]\n\n"
             "MODE is:\n"
             "  -dc     dump config\n"
             "  -ds     dump status\n"
+            "  -dj     dump status as JSON\n"
+            "  -dv     dump status as CSV\n"
+            "  -dl     dump built-in language (number, default 0=English) as message catalog\n"
+            "  -cl     compile message catalog\n"
+            "  --ingest  pre-parse a player's commands (at turn upload)\n"
+            "  -q      query state as JSON: score PLAYER, planet ID, inventory PLAYER, votes\n"
+            "  --league  compute standings across the games listed in SPECFILE\n"
             "  -i      c2host integration (c2ref.txt, c2score.txt)\n"
+            "  -1      AUXHOST1 stage: send configuration, pre-parse all commands\n"
+            "  -2      AUXHOST2 stage after -1: build, score, vote, report\n"
+            "  -vN     log level (0=warnings, 1=phases, 2=actions, 3=details), overrides config\n"
+            "  --metrics  write Prometheus metrics to DIR instead of game directory\n"
+            "  --scoreboard  update game's standings in farm-wide FILE\n"
+            "  --batch   process all games listed in LISTFILE, N in parallel\n"
+            "  --daemon  serve requests on SOCKET, with N workers\n"
+            "  --client  process a game using a daemon\n"
             "  --help  this message\n\n"
             "Written in 2021-2022 by Stefan Reuther <streu@gmx.de> for PlanetsCentral\n"
             "Based upon Cactus 2001++ by K.Kopytov, E.Goroh\n",
-            BANNER, VERSION, name);
+            BANNER, VERSION, name, name, name, name, name, name, name, name, name);
 }
 
-static void InitHostAction(struct Config* c)
+/* Initialize for a host action.
+   We only need planet owners, colonists, starbases, friendly codes, names and player status,
+   but the PDK offers no finer granularity than ReadGlobalData()/ReadHostData().
+   Modes that do not need the universe (--ingest, -dc, -ds) do not call this.
+   With appendLog, the log continues that of the AUXHOST1 stage. */
+static void InitHostAction(struct Config* c, Boolean appendLog)
 {
+    Stats_Phase("load");
     InitPHOSTLib();
-    gLogFile = OpenOutputFile(LOG_FILE, GAME_DIR_ONLY | TEXT_MODE);
-    Info("Loading...");
+    gLogFile = OpenOutputFile(LOG_FILE, GAME_DIR_ONLY | TEXT_MODE | (appendLog ? APPEND_MODE : 0));
+    LOG_PHASE("Loading...");
     if (!ReadGlobalData()) {
+        Log_Flush();
         FreePHOSTLib();
         ErrorExit("Unable to read global data");
     }
     if (!ReadHostData()) {
+        Log_Flush();
         FreePHOSTLib();
         ErrorExit("Unable to read host data");
     }
-    Config_Load(c);
+    Config_Load(c, True);
+    if (gLogLevel < 0) {
+        Log_SetLevel(c->LogLevel);
+    }
+    Language_Load();
 
     // Set util.tmp mode. This causes our util.dat records come out in the right order.
     // In particular, our mine scans come out before PHost's.
     SetUtilMode(UTIL_Tmp);
 }
 
-static void DoneHostAction()
+/* Finish a host action: write host data and statistics.
+   Metrics describe a complete turn, so they are only saved if pState is given (HostAction, not PrepareAction). */
+static void DoneHostAction(const struct State* pState, const char* statsFileName)
 {
-    Info("Saving...");
-    if (!WriteHostData()) {
-        FreePHOSTLib();
-        ErrorExit("Unable to write host data");
+    // We never modify the universe, only produce messages and util.dat records.
+    // The PDK can only write all host data at once, so skip that only if we produced nothing;
+    // in case of doubt, write.
+    Stats_Phase("write");
+    if (Stats_Get(Stat_Messages) == 0 && Stats_Get(Stat_UtilRecords) == 0) {
+        LOG_PHASE("Nothing to save.");
+    } else {
+        LOG_PHASE("Saving...");
+        if (!WriteHostData()) {
+            Log_Flush();
+            FreePHOSTLib();
+            ErrorExit("Unable to write host data");
+        }
+    }
+    Stats_Save(statsFileName);
+    if (pState != 0) {
+        Metrics_Save(pState, gMetricsDirectory);
     }
+    Log_Flush();
+    Language_Free();
     FreePHOSTLib();
 }
 
@@ -79,33 +170,217 @@ static void DoneHostAction()
  *  HostAction mode
  */
 
-static void DoHostAction(Boolean integrate)
+static void DoHostAction(Boolean integrate, Boolean prepared)
 {
     struct Config c;
-    InitHostAction(&c);
+    InitHostAction(&c, prepared);
 
-    Info("Agave Tequilana v%s", VERSION);
+    LOG_PHASE("Agave Tequilana v%s", VERSION);
     struct State* pState = State_Create();
     State_Load(pState, True);
     State_UpdateCounts(pState);
 
-    DoSendConfig(&c);
-    ProcessCommands(pState, &c);
-    if (c.ProcessMessages) {
-        ProcessMessages(pState, &c);
+    if (!prepared) {
+        Stats_Phase("config");
+        DoSendConfig(&c);
     }
-    ProcessBuildRequests(pState, &c);
+    struct CommandReport report;
+    CommandReport_Init(&report);
+    Stats_Phase("commands");
+    ProcessCommands(pState, &c, &report);
+    Stats_Phase("builds");
+    ProcessBuildRequests(pState, &c, &report);
+    CommandReport_Send(&report, &c);
+    Stats_Phase("scores");
     ComputeScores(pState, &c);
+    Stats_Phase("votes");
     ProcessVotes(pState, &c, integrate);
+    Stats_Phase("reports");
     SendReports(pState, &c);
+
+    Stats_Phase("save");
     if (integrate) {
         SaveScoreFile(pState);
     }
-
     State_Save(pState);
+    Events_Save();
+    if (gScoreboardFile != 0) {
+        Scoreboard_Update(pState, gScoreboardFile);
+    }
+    DoneHostAction(pState, STATS_FILE);
+    State_Destroy(pState);
+}
+
+/*
+ *  PrepareAction mode
+ *
+ *  Does everything that does not depend on movement,
+ *  so the AUXHOST2 part becomes shorter.
+ */
+
+static void DoPrepareAction()
+{
+    struct Config c;
+    InitHostAction(&c, False);
+
+    LOG_PHASE("Agave Tequilana v%s (AUXHOST1)", VERSION);
+    struct State* pState = State_Create();
+    State_Load(pState, False);
+
+    Stats_Phase("config");
+    DoSendConfig(&c);
+    Stats_Phase("ingest");
+    LOG_PHASE("    Pre-parsing commands...");
+    IngestCommands(0, pState, &c);
+
+    DoneHostAction(0, PREPARE_STATS_FILE);
     State_Destroy(pState);
+}
+
+/*
+ *  Batch and Daemon Modes
+ */
+
+/** Options for a game processed in batch or daemon mode.
+    @private */
+struct HostOptions {
+    Boolean Prepare;                    ///< True for PrepareAction, false for HostAction.
+    Boolean Integrate;                  ///< HostAction: c2host integration.
+    Boolean Prepared;                   ///< HostAction: PrepareAction has been run before.
+    int LogLevel;                       ///< Log level; -1 to use configuration.
+};
+
+static void DoHostGame(void* pData)
+{
+    const struct HostOptions* p = pData;
+    gLogLevel = p->LogLevel;
+    if (gLogLevel >= 0) {
+        Log_SetLevel(gLogLevel);
+    }
+    if (p->Prepare) {
+        DoPrepareAction();
+    } else {
+        DoHostAction(p->Integrate, p->Prepared);
+    }
+}
+
+/** Separator between words of a daemon request.
+    Game and root directory may contain spaces, so a tab is used; FormatDaemonRequest() rejects paths containing one.
+    @private */
+#define DAEMON_SEPARATOR "\t"
+
+/* Serve a daemon request, "run GAMEDIR [ROOTDIR] [-vN] [-i] [-1|-2]", words separated by DAEMON_SEPARATOR. */
+static void DoDaemonRequest(char* request, void* pData)
+{
+    struct HostOptions opts;
+    int numArgs = 0;
+    (void) pData;
+    opts.Prepare = False;
+    opts.Integrate = False;
+    opts.Prepared = False;
+    opts.LogLevel = -1;
+
+    const char* verb = strtok(request, DAEMON_SEPARATOR);
+    if (verb == 0 || strcmp(verb, "run") != 0) {
+        printf("Invalid request\n");
+        exit(1);
+    }
+
+    const char* p;
+    while ((p = strtok(0, DAEMON_SEPARATOR)) != 0) {
+        if (strcmp(p, "-i") == 0) {
+            opts.Integrate = True;
+        } else if (strcmp(p, "-1") == 0) {
+            opts.Prepare = True;
+        } else if (strcmp(p, "-2") == 0) {
+            opts.Prepared = True;
+        } else if (p[0] == '-' && p[1] == 'v' && p[2] >= '0' && p[2] <= '9') {
+            opts.LogLevel = atoi(p+2);
+        } else if (*p != '-' && numArgs == 0) {
+            gGameDirectory = p;
+            ++numArgs;
+        } else if (*p != '-' && numArgs == 1) {
+            gRootDirectory = p;
+            ++numArgs;
+        } else {
+            printf("Invalid request\n");
+            exit(1);
+        }
+    }
+    if (numArgs == 0) {
+        printf("Invalid request\n");
+        exit(1);
+    }
+    if (!Daemon_LockGame(gGameDirectory)) {
+        exit(1);
+    }
+    DoHostGame(&opts);
+}
+
+/* Build a daemon request from command line options.
+   Returns false if a path cannot be transmitted. */
+static Boolean FormatDaemonRequest(char* buffer, size_t size, const char*const* args, int numArgs, const struct HostOptions* p)
+{
+    char logLevel[20] = "";
+    if (p->LogLevel >= 0) {
+        snprintf(logLevel, sizeof(logLevel), DAEMON_SEPARATOR "-v%d", p->LogLevel);
+    }
+
+    for (int i = 0; i < numArgs && i < 2; ++i) {
+        if (strpbrk(args[i], DAEMON_SEPARATOR "\r\n") != 0) {
+            fprintf(stderr, "%s: path must not contain tabs or line breaks\n", args[i]);
+            return False;
+        }
+    }
+
+    char gameDir[400];
+    char rootDir[400] = "";
+    Daemon_MakeAbsolutePath(gameDir, sizeof(gameDir), args[0]);
+    if (numArgs > 1) {
+        Daemon_MakeAbsolutePath(rootDir, sizeof(rootDir), args[1]);
+    }
+    snprintf(buffer, size, "run" DAEMON_SEPARATOR "%s%s%s%s%s%s%s",
+             gameDir,
+             numArgs > 1 ? DAEMON_SEPARATOR : "",
+             rootDir,
+             logLevel,
+             p->Integrate ? DAEMON_SEPARATOR "-i" : "",
+             p->Prepare ? DAEMON_SEPARATOR "-1" : "",
+             p->Prepared ? DAEMON_SEPARATOR "-2" : "");
+    return True;
+}
+
+/*
+ *  Ingest Mode
+ */
+
+static int DoIngest(const char* playerArg)
+{
+    int player = atoi(playerArg);
+    if (player <= 0 || player > RACE_NR) {
+        fprintf(stderr, "Invalid player number: %s\n", playerArg);
+        return 1;
+    }
+
+    InitPHOSTLib();
+    if (!ReadGlobalData()) {
+        FreePHOSTLib();
+        ErrorExit("Unable to read global data");
+    }
 
-    DoneHostAction();
+    // Ingest runs while the player uploads, possibly during a host run; leave the cache to the host.
+    struct Config c;
+    Config_Load(&c, False);
+    if (gLogLevel < 0) {
+        Log_SetLevel(c.LogLevel);
+    }
+    struct State* pState = State_Create();
+    State_Load(pState, False);
+    Boolean ok = IngestCommands((RaceType_Def) player, pState, &c);
+    State_Destroy(pState);
+    Log_Flush();
+    FreePHOSTLib();
+    return ok ? 0 : 1;
 }
 
 /*
@@ -122,8 +397,8 @@ static void DoDumpConfig()
 {
     struct Config c;
     InitPHOSTLib();
-    Config_Load(&c);
-    Config_Format(&c, DumpConfig_Show, NULL);
+    Config_Load(&c, False);
+    Config_Format(&c, True, DumpConfig_Show, NULL);
     FreePHOSTLib();
 }
 
@@ -139,6 +414,98 @@ static void DoDumpStatus()
     State_Destroy(pState);
 }
 
+static void DoExportStatus(enum StateFormat format)
+{
+    struct State* pState = State_Create();
+    State_Load(pState, False);
+    State_Export(pState, format, stdout);
+    State_Destroy(pState);
+}
+
+/*
+ *  Query mode
+ *
+ *  Answers a single question about the state, as a JSON object.
+ *  This reads only cactus.hst, without initializing the PDK,
+ *  so it is fast enough to be called from a web frontend for every request.
+ */
+
+/* Parse a number in range [1,max]. Returns 0 if invalid. */
+static int ParseQueryArg(const char* arg, int max)
+{
+    char* end;
+    long n = (arg != 0 ? strtol(arg, &end, 10) : 0);
+    return (arg != 0 && *end == '\0' && n >= 1 && n <= max) ? (int) n : 0;
+}
+
+static int DoQuery(const char* query, const char* arg)
+{
+    struct State* pState = State_Create();
+    State_Load(pState, False);
+
+    int result = 0;
+    if (strcmp(query, "score") == 0 && ParseQueryArg(arg, RACE_NR) != 0) {
+        const RaceType_Def player = (RaceType_Def) ParseQueryArg(arg, RACE_NR);
+        printf("{\"turn\":%d,\"player\":%d,\"score\":%d,\"built\":%d,\"owned\":%d,\"vote\":%s}\n",
+               (int) State_PreviousTurn(pState), (int) player,
+               (int) State_Score(pState, player),
+               State_NumBuiltCactuses(pState, player),
+               State_NumOwnedCactuses(pState, player),
+               State_HasVote(pState, player) ? "true" : "false");
+    } else if (strcmp(query, "planet") == 0 && ParseQueryArg(arg, PLANET_NR) != 0) {
+        const Uns16 planetId = (Uns16) ParseQueryArg(arg, PLANET_NR);
+        printf("{\"turn\":%d,\"planet\":%d,\"owner\":%d,\"builder\":%d,\"type\":\"%s\"}\n",
+               (int) State_PreviousTurn(pState), (int) planetId,
+               (int) State_PlanetOwner(pState, planetId),
+               (int) State_CactusBuilder(pState, planetId),
+               State_CactusTypeName(pState, planetId));
+    } else if (strcmp(query, "inventory") == 0 && ParseQueryArg(arg, RACE_NR) != 0) {
+        const RaceType_Def player = (RaceType_Def) ParseQueryArg(arg, RACE_NR);
+        const char* sep = "";
+        printf("{\"turn\":%d,\"player\":%d,\"cactuses\":[", (int) State_PreviousTurn(pState), (int) player);
+        for (Uns16 planetId = 1; planetId <= PLANET_NR; ++planetId) {
+            // Like the inventory report: cactuses on the player's planets, and stumps the player built elsewhere (exiles)
+            const RaceType_Def owner = State_PlanetOwner(pState, planetId);
+            const RaceType_Def builder = State_CactusBuilder(pState, planetId);
+            if (State_PlanetHasCactus(pState, planetId) && (owner == player || builder == player)) {
+                printf("%s{\"planet\":%d,\"owner\":%d,\"builder\":%d,\"type\":\"%s\",\"exile\":%s}", sep, (int) planetId,
+                       (int) owner, (int) builder, State_CactusTypeName(pState, planetId),
+                       owner != player ? "true" : "false");
+                sep = ",";
+            }
+        }
+        printf("]}\n");
+    } else if (strcmp(query, "votes") == 0 && arg == 0) {
+        const char* sep = "";
+        printf("{\"turn\":%d,\"votes\":[", (int) State_PreviousTurn(pState));
+        for (int i = 1; i <= RACE_NR; ++i) {
+            printf("%s{\"player\":%d,\"vote\":%s}", sep, i, State_HasVote(pState, (RaceType_Def) i) ? "true" : "false");
+            sep = ",";
+        }
+        printf("]}\n");
+    } else {
+        fprintf(stderr, "Invalid query\n");
+        result = 1;
+    }
+
+    State_Destroy(pState);
+    return result;
+}
+
+/*
+ *  DumpLanguage/CompileLanguage modes
+ */
+
+static void DoDumpLanguage(const char* lang)
+{
+    Language_Dump((Language_Def) (lang != 0 ? atoi(lang) : 0), stdout);
+}
+
+static int DoCompileLanguage(const char* sourceName, const char* targetName)
+{
+    return Language_Compile(sourceName, targetName) ? 0 : 1;
+}
+
 /**
  *  Main Entry Point.
  *
@@ -154,8 +521,12 @@ int main(int argc, char** argv)
 
     // Parse command line
     int i = 1;
-    Boolean hasGame = False, hasRoot = False;
+    const char* args[3];
+    int numArgs = 0;
     Boolean integrate = False;
+    Boolean prepared = False;
+    enum Driver driver = Driver_Direct;
+    int numJobs = 0;
     while (argv[i] != 0) {
         const char* p = argv[i];
         if (*p == '-') {
@@ -167,22 +538,50 @@ int main(int argc, char** argv)
                 mode = DumpConfig;
             } else if (strcmp(p, "ds") == 0) {
                 mode = DumpStatus;
+            } else if (strcmp(p, "dj") == 0) {
+                mode = DumpJSON;
+            } else if (strcmp(p, "dv") == 0) {
+                mode = DumpCSV;
+            } else if (strcmp(p, "q") == 0) {
+                mode = Query;
+            } else if (strcmp(p, "dl") == 0) {
+                mode = DumpLanguage;
+            } else if (strcmp(p, "cl") == 0) {
+                mode = CompileLanguage;
+            } else if (strcmp(p, "batch") == 0) {
+                driver = Driver_Batch;
+            } else if (strcmp(p, "daemon") == 0) {
+                driver = Driver_Daemon;
+            } else if (strcmp(p, "client") == 0) {
+                driver = Driver_Client;
+            } else if (p[0] == 'j' && p[1] >= '1' && p[1] <= '9') {
+                numJobs = atoi(p+1);
+            } else if (strcmp(p, "metrics") == 0 && argv[i+1] != 0) {
+                gMetricsDirectory = argv[++i];
+            } else if (strcmp(p, "scoreboard") == 0 && argv[i+1] != 0) {
+                gScoreboardFile = argv[++i];
+            } else if (p[0] == 'v' && p[1] >= '0' && p[1] <= '9') {
+                gLogLevel = atoi(p+1);
+                Log_SetLevel(gLogLevel);
+            } else if (strcmp(p, "ingest") == 0) {
+                mode = Ingest;
+            } else if (strcmp(p, "league") == 0) {
+                mode = League;
             } else if (strcmp(p, "i") == 0) {
                 integrate = True;
+            } else if (strcmp(p, "1") == 0) {
+                mode = PrepareAction;
+            } else if (strcmp(p, "2") == 0) {
+                prepared = True;
             } else if (strcmp(p, "help") == 0 || strcmp(p, "h") == 0) {
                 mode = Help;
             } else {
                 PrintUsage(stderr, argv[0]);
                 return 1;
             }
-        } else if (!hasGame) {
-            // Game directory
-            gGameDirectory = p;
-            hasGame = True;
-        } else if (!hasRoot) {
-            // Root directory
-            gRootDirectory = p;
-            hasRoot = True;
+        } else if (numArgs < 3) {
+            // Game directory, root directory; or mode-specific arguments
+            args[numArgs++] = p;
         } else {
             // Excess non-option
             PrintUsage(stderr, argv[0]);
@@ -191,15 +590,82 @@ int main(int argc, char** argv)
         ++i;
     }
 
-    if ((mode != Help && mode != DumpConfig) && !hasGame) {
-        // No command-line option at all
+    if (driver != Driver_Direct) {
+        static const int MIN_ARGS[] = { 0, 1, 1, 2 };
+        static const int MAX_ARGS[] = { 0, 2, 1, 3 };
+        if ((mode != HostAction && mode != PrepareAction) || numArgs < MIN_ARGS[driver] || numArgs > MAX_ARGS[driver]) {
+            PrintUsage(stderr, argv[0]);
+            return 1;
+        }
+        if (driver == Driver_Batch && numArgs > 1) {
+            gRootDirectory = args[1];
+        }
+    } else if (numArgs > (mode == Query ? 3 : 2)) {
         PrintUsage(stderr, argv[0]);
         return 1;
+    } else if (mode == DumpLanguage || mode == CompileLanguage) {
+        if (mode == CompileLanguage ? numArgs != 2 : numArgs > 1) {
+            PrintUsage(stderr, argv[0]);
+            return 1;
+        }
+    } else if (mode == Ingest) {
+        if (numArgs != 2) {
+            PrintUsage(stderr, argv[0]);
+            return 1;
+        }
+        gGameDirectory = args[0];
+    } else if (mode == League) {
+        if (numArgs != 1) {
+            PrintUsage(stderr, argv[0]);
+            return 1;
+        }
+    } else if (mode == Query) {
+        if (numArgs < 2) {
+            PrintUsage(stderr, argv[0]);
+            return 1;
+        }
+        gGameDirectory = args[0];
+    } else {
+        if (numArgs > 0) {
+            gGameDirectory = args[0];
+        }
+        if (numArgs > 1) {
+            gRootDirectory = args[1];
+        }
+        if ((mode != Help && mode != DumpConfig) && numArgs == 0) {
+            // No command-line option at all
+            PrintUsage(stderr, argv[0]);
+            return 1;
+        }
+    }
+
+    struct HostOptions opts;
+    opts.Prepare = (mode == PrepareAction);
+    opts.Integrate = integrate;
+    opts.Prepared = prepared;
+    opts.LogLevel = gLogLevel;
+    switch (driver) {
+     case Driver_Direct:
+        break;
+     case Driver_Batch:
+        return Batch_Run(args[0], numJobs, DoHostGame, &opts) ? 0 : 1;
+     case Driver_Daemon:
+        return Daemon_Run(args[0], numJobs, DoDaemonRequest, 0) ? 0 : 1;
+     case Driver_Client: {
+        char request[1024];
+        if (!FormatDaemonRequest(request, sizeof(request), args+1, numArgs-1, &opts)) {
+            return 1;
+        }
+        return Daemon_Request(args[0], request) ? 0 : 1;
+     }
     }
 
     switch (mode) {
      case HostAction:
-        DoHostAction(integrate);
+        DoHostAction(integrate, prepared);
+        break;
+     case PrepareAction:
+        DoPrepareAction();
         break;
      case DumpConfig:
         DoDumpConfig();
@@ -207,6 +673,23 @@ int main(int argc, char** argv)
      case DumpStatus:
         DoDumpStatus();
         break;
+     case DumpJSON:
+        DoExportStatus(StateFormat_JSON);
+        break;
+     case DumpCSV:
+        DoExportStatus(StateFormat_CSV);
+        break;
+     case DumpLanguage:
+        DoDumpLanguage(numArgs > 0 ? args[0] : 0);
+        break;
+     case CompileLanguage:
+        return DoCompileLanguage(args[0], args[1]);
+     case Ingest:
+        return DoIngest(args[1]);
+     case Query:
+        return DoQuery(args[1], numArgs > 2 ? args[2] : 0);
+     case League:
+        return League_Run(args[0]) ? 0 : 1;
      case Help:
         PrintUsage(stdout, argv[0]);
         break;
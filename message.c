@@ -7,9 +7,9 @@
 #include <string.h>
 #include "message.h"
 #include "language.h"
+#include "stats.h"
 #include "version.h"
 
-
 void Message_Init(struct Message* m)
 {
     m->Length = 0;
@@ -54,8 +54,12 @@ void Message_Format(struct Message* m, const char* tpl, const Int32* args, size_
                 index = 10*index + (*tpl++ - '0');
             }
 
-            // Format it
-            char fmt = *tpl++;
+            // Format it. Templates can come from a message catalog; stop at an incomplete placeholder.
+            char fmt = *tpl;
+            if (fmt == '\0') {
+                break;
+            }
+            ++tpl;
             char tmp[100];
             switch (fmt) {
              case '%':
@@ -129,6 +133,8 @@ void Message_Send(struct Message* m, RaceType_Def to)
     assert(m->Length < sizeof(m->Content));
     m->Content[m->Length] = '\0';
     WriteAUXHOSTMessage(to, m->Content);
+    Stats_Add(Stat_Messages, 1);
+    Stats_Add(Stat_BytesWritten, (Uns32) m->Length);
 }
 
 void Message_SendTemplate(RaceType_Def to, const char* tpl, const Int32* args, size_t numArgs)
@@ -154,6 +160,27 @@ void Message_CommandSyntaxError(RaceType_Def to, const char* cmd)
     Message_Send(&m, to);
 }
 
+void Message_CommandSummary(RaceType_Def to, int numErrors, int numDropped, int commandLimit, int numNotOwned, int numNotEligible)
+{
+    const struct Language* lang = GetLanguageForPlayer(to);
+    struct Message m;
+    Message_Init(&m);
+    Message_Add(&m, lang->Message_CommandSummary_Header);
+    if (numErrors != 0) {
+        Int32 args[] = { numErrors };
+        Message_Format(&m, lang->Message_CommandSummary_Errors, args, 1);
+    }
+    if (numDropped != 0) {
+        Int32 args[] = { numDropped, commandLimit };
+        Message_Format(&m, lang->Message_CommandSummary_Dropped, args, 2);
+    }
+    if (numNotOwned != 0 || numNotEligible != 0) {
+        Int32 args[] = { numNotOwned + numNotEligible, numNotOwned, numNotEligible };
+        Message_Format(&m, lang->Message_CommandSummary_Skipped, args, 3);
+    }
+    Message_Send(&m, to);
+}
+
 void Message_ScoreReport(RaceType_Def to, int numOwnedCactuses, int numBuiltCactuses, int score, Boolean vote, int numVotes)
 {
     Int32 args[] = { numOwnedCactuses, numBuiltCactuses, score, vote, numVotes };
@@ -95,6 +95,15 @@ void Message_SendTemplate(RaceType_Def to, const char* tpl, const Int32* args, s
     @param cmd Failing command */
 void Message_CommandSyntaxError(RaceType_Def to, const char* cmd);
 
+/** Report summary of commands that were not processed.
+    @param to           Player
+    @param numErrors    Number of failed commands not reported individually
+    @param numDropped   Number of commands ignored due to limit
+    @param commandLimit Command limit
+    @param numNotOwned  Number of planets skipped in bulk build commands because they are not owned
+    @param numNotEligible Number of planets skipped in bulk build commands because they are not eligible */
+void Message_CommandSummary(RaceType_Def to, int numErrors, int numDropped, int commandLimit, int numNotOwned, int numNotEligible);
+
 /** Score report.
     @param to  Player
     @param numOwnedCactuses  Number of cactuses owned
@@ -0,0 +1,145 @@
+/**
+  *  \file metrics.c
+  *  \brief Agave Tequilana - Prometheus Metrics Export
+  */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <time.h>
+#include "metrics.h"
+#include "log.h"
+#include "stats.h"
+
+static const char*const METRICS_FILE_NAME = "cactus.prom";
+
+/** Maximum length of a file name.
+    @private */
+#define MAX_FILE_NAME 1024
+
+/* Write a label value, escaped. */
+static void WriteLabelValue(FILE* fp, const char* value)
+{
+    for (const char* p = value; *p != '\0'; ++p) {
+        switch (*p) {
+         case '\\': fputs("\\\\", fp); break;
+         case '"':  fputs("\\\"", fp); break;
+         case '\n': fputs("\\n", fp);  break;
+         default:   fputc(*p, fp);     break;
+        }
+    }
+}
+
+/* Write metadata for a metric. */
+static void WriteHeader(FILE* fp, const char* name, const char* help)
+{
+    fprintf(fp, "# HELP %s %s\n# TYPE %s gauge\n", name, help, name);
+}
+
+/* Start a sample line, up to and including the game label. */
+static void WriteSampleStart(FILE* fp, const char* name)
+{
+    fprintf(fp, "%s{game=\"", name);
+    WriteLabelValue(fp, gGameDirectory);
+    fputc('"', fp);
+}
+
+/* Write a sample without further labels. */
+static void WriteSample(FILE* fp, const char* name, const char* help, double value)
+{
+    WriteHeader(fp, name, help);
+    WriteSampleStart(fp, name);
+    fprintf(fp, "} %.15g\n", value);
+}
+
+/* Write per-player gauges. */
+static void WritePlayerMetric(FILE* fp, const struct State* pState, const char* name, const char* help, int get(const struct State*, RaceType_Def))
+{
+    WriteHeader(fp, name, help);
+    for (int i = 1; i <= RACE_NR; ++i) {
+        const RaceType_Def r = (RaceType_Def) i;
+        if (PlayerIsActive(r)) {
+            WriteSampleStart(fp, name);
+            fprintf(fp, ",player=\"%d\"} %d\n", i, get(pState, r));
+        }
+    }
+}
+
+/* Adaptor for State_Score(), to match the other player getters. */
+static int GetScore(const struct State* pState, RaceType_Def race)
+{
+    return State_Score(pState, race);
+}
+
+/* Build file name. Returns false if it does not fit. */
+static Boolean BuildFileName(char* buffer, size_t size, const char* dirName)
+{
+    int n;
+    if (dirName == 0) {
+        n = snprintf(buffer, size, "%s/%s", gGameDirectory, METRICS_FILE_NAME);
+    } else {
+        n = snprintf(buffer, size, "%s/cactus_", dirName);
+        for (const char* p = gGameDirectory; *p != '\0' && n > 0 && (size_t) n < size-1; ++p) {
+            buffer[n++] = isalnum((unsigned char) *p) ? *p : '_';
+        }
+        if (n > 0 && (size_t) n < size) {
+            n += snprintf(buffer + n, size - (size_t) n, ".prom");
+        }
+    }
+    return n > 0 && (size_t) n < size;
+}
+
+
+/*
+ *  Public Interface
+ */
+
+void Metrics_Save(const struct State* pState, const char* dirName)
+{
+    char fileName[MAX_FILE_NAME];
+    char tempName[MAX_FILE_NAME + 4];
+    if (!BuildFileName(fileName, sizeof(fileName), dirName)) {
+        LOG_WARNING("Metrics file name too long, not written");
+        return;
+    }
+    snprintf(tempName, sizeof(tempName), "%s.tmp", fileName);
+
+    FILE* fp = fopen(tempName, "w");
+    if (fp == 0) {
+        LOG_WARNING("Unable to create %s", tempName);
+        return;
+    }
+
+    // Game
+    WriteSample(fp, "cactus_turn", "Turn number processed.", TurnNumber());
+    WriteSample(fp, "cactus_last_run_timestamp_seconds", "Time of the last run.", (double) time(0));
+    WriteSample(fp, "cactus_finished", "1 if the game has been decided.", State_IsFinished(pState) ? 1 : 0);
+
+    // Players
+    WritePlayerMetric(fp, pState, "cactus_player_score", "Score of each player.", GetScore);
+    WritePlayerMetric(fp, pState, "cactus_player_owned_cactuses", "Number of cactuses owned by each player.", State_NumOwnedCactuses);
+    WritePlayerMetric(fp, pState, "cactus_player_built_cactuses", "Number of cactuses built by each player (for cost).", State_NumBuiltCactuses);
+
+    // This turn's events
+    WriteSample(fp, "cactus_builds", "Cactuses built this turn.", Stats_Get(Stat_CactusesBuilt));
+    WriteHeader(fp, "cactus_build_failures", "Build requests failed this turn, by reason.");
+    for (int i = Stat_FailNotOwned; i <= Stat_FailMinScore; ++i) {
+        WriteSampleStart(fp, "cactus_build_failures");
+        fprintf(fp, ",reason=\"%s\"} %lu\n", Stats_GetName((enum Stat) i) + 5 /* skip "fail_" */, (unsigned long) Stats_Get((enum Stat) i));
+    }
+    WriteSample(fp, "cactus_captures", "Cactuses captured this turn.", Stats_Get(Stat_Captures));
+    WriteSample(fp, "cactus_losses", "Cactuses lost to no owner this turn.", Stats_Get(Stat_Losses));
+    WriteSample(fp, "cactus_votes", "Votes of all players.", Stats_Get(Stat_TotalVotes));
+    WriteSample(fp, "cactus_yes_votes", "Votes to end the game.", Stats_Get(Stat_YesVotes));
+
+    // Run time
+    WriteHeader(fp, "cactus_phase_seconds", "Time spent in each phase of the last run.");
+    for (size_t i = 0; i < Stats_NumPhases(); ++i) {
+        WriteSampleStart(fp, "cactus_phase_seconds");
+        fprintf(fp, ",phase=\"%s\"} %.6f\n", Stats_PhaseName(i), Stats_PhaseTime(i));
+    }
+
+    if (fclose(fp) != 0 || rename(tempName, fileName) != 0) {
+        LOG_WARNING("Unable to write %s", fileName);
+        remove(tempName);
+    }
+}
@@ -0,0 +1,27 @@
+/**
+  *  \file metrics.h
+  *  \brief Agave Tequilana - Prometheus Metrics Export
+  */
+#ifndef METRICS_H_INCLUDED
+#define METRICS_H_INCLUDED
+
+#include "state.h"
+
+/** Save metrics.
+    Writes per-player scores and cactus counts from the state, the counters and phase times from the stats module,
+    in Prometheus text exposition format, for use with the node exporter's textfile collector.
+    All metrics have a `game` label containing the game directory.
+
+    The file is written under a temporary name and then renamed, so a reader never sees a partial file.
+
+    Call after Stats_Save(), so that phase times are complete.
+
+    @param [in] pState   State
+    @param [in] dirName  Directory to write to. If null, writes `cactus.prom` in the game directory;
+                         otherwise, writes `cactus_GAME.prom` into the given directory,
+                         where GAME is derived from the game directory name,
+                         so that multiple games can share one directory.
+    @pre PDK initialized (gGameDirectory set) */
+void Metrics_Save(const struct State* pState, const char* dirName);
+
+#endif
@@ -7,9 +7,13 @@
 
 #include <phostpdk.h>
 #include <stdlib.h>
+#include <string.h>
 #include "score.h"
+#include "events.h"
 #include "message.h"
 #include "language.h"
+#include "log.h"
+#include "stats.h"
 #include "utildata.h"
 #include "util.h"
 
@@ -18,19 +22,6 @@
  *  Buiding
  */
 
-/** Result for ProcessBuildRequest.
-    @private */
-enum Result {
-    Success,
-    Fail_NotOwned,
-    Fail_HasFullCactus,
-    Fail_CannotRebuild,
-    Fail_NeedBase,
-    Fail_ClansRequired,
-    Fail_CactusLimit,
-    Fail_MinScore
-};
-
 /* Compute a * b^exp. */
 static int Power(int a, int b, int exp)
 {
@@ -54,43 +45,56 @@ static int CactusCost(const struct State* pState, const struct Config* pConfig,
     return pConfig->CostAdditive + Power(pConfig->CostMultiplier, State_NumBuiltCactuses(pState, owner) - (int)buildingOverStump, pConfig->CostPower);
 }
 
-/* Process a single build request.
-   Will either build the cactus and send necessary messages,
-   or not build the cactus and return a failure status. */
-static enum Result ProcessBuildRequest(struct State* pState, const struct Config* pConfig, const Uns16 planetId)
+/* Check planet-level conditions for building a cactus.
+   These do not depend on the builder, nor on other cactuses built this turn. */
+static enum BuildResult CheckPlanet(const struct State* pState, const struct Config* pConfig, const Uns16 planetId)
 {
-    // Command has been validated against State_PlanetOwner.
-    // Check whether that still is current or player has lost the planet.
-    const RaceType_Def race = PlanetOwner(planetId);
-    if (race != State_PlanetOwner(pState, planetId)) {
-        return Fail_NotOwned;
-    }
-
     // Cannot build if there is already a full cactus.
     if (State_PlanetHasFullCactus(pState, planetId)) {
-        return Fail_HasFullCactus;
+        return Build_FailHasFullCactus;
     }
 
     // Cannot build over a stump unless allowed.
     if (State_PlanetHasCactus(pState, planetId) && !pConfig->RebuildCactus) {
-        return Fail_CannotRebuild;
+        return Build_FailCannotRebuild;
     }
 
     // Might require a base.
     if (pConfig->NeedBase && !IsBaseExist(planetId)) {
-        return Fail_NeedBase;
+        return Build_FailNeedBase;
     }
 
     // Might require clans.
     if (PlanetCargo(planetId, COLONISTS)/100 < (Uns32)pConfig->ClansRequired) {
-        return Fail_ClansRequired;
+        return Build_FailClansRequired;
+    }
+
+    return Build_Success;
+}
+
+/* Process a single build request.
+   Will either build the cactus and send necessary messages,
+   or not build the cactus and return a failure status. */
+static enum BuildResult ProcessBuildRequest(struct State* pState, const struct Config* pConfig, const Uns16 planetId)
+{
+    // Command has been validated against State_PlanetOwner.
+    // Check whether that still is current or player has lost the planet.
+    const RaceType_Def race = PlanetOwner(planetId);
+    if (race != State_PlanetOwner(pState, planetId)) {
+        return Build_FailNotOwned;
+    }
+
+    // Planet conditions
+    const enum BuildResult planetResult = CheckPlanet(pState, pConfig, planetId);
+    if (planetResult != Build_Success) {
+        return planetResult;
     }
 
     // Check limit.
     // Note that building over an own stump must be treated specially because it doesn't change the net count.
     const Boolean buildingOverStump = (State_PlanetHasCactus(pState, planetId) && State_CactusBuilder(pState, planetId) == race);
     if (pConfig->CactusLimit > 0 && State_NumBuiltCactuses(pState, race) - (Int16)buildingOverStump >= pConfig->CactusLimit) {
-        return Fail_CactusLimit;
+        return Build_FailCactusLimit;
     }
 
     // Compute cost. Must be done before State_CreateCactus() to use correct count.
@@ -103,32 +107,42 @@ static enum Result ProcessBuildRequest(struct State* pState, const struct Config
         && (currentScore < pConfig->MinScore
             || cost > (Int32)currentScore - pConfig->MinScore))
     {
-        return Fail_MinScore;
+        return Build_FailMinScore;
     }
 
     // All conditions pass, do it
-    Info("\t(+) build cactus: planet %d, player %d, cost %d", planetId, race, cost);
+    LOG_INFO("\t(+) build cactus: planet %d, player %d, cost %d", planetId, race, cost);
     State_CreateCactus(pState, planetId, race);
     State_AddScore(pState, race, -cost);
 
     // Messaging
     Message_CactusBuilt(race, planetId, cost);
+    Events_Add(Event_Built, race, planetId, cost);
+
+    return Build_Success;
+}
 
-    return Success;
+Boolean IsBuildEligible(const struct State* pState, const struct Config* pConfig, Uns16 planetId)
+{
+    return CheckPlanet(pState, pConfig, planetId) == Build_Success;
 }
 
-void ProcessBuildRequests(struct State* pState, const struct Config* pConfig)
+void ProcessBuildRequests(struct State* pState, const struct Config* pConfig, struct CommandReport* pReport)
 {
     // Perform building in a loop.
     // Building cactus A may enable cactus B being built when A builds over a stump built by B
     // and therefore reduces B's NumBuiltCactuses below CactusLimit.
     while (1) {
-        Info("    Building...");
+        LOG_PHASE("    Building...");
+        Stats_Add(Stat_BuildRounds, 1);
+        Stats_Add(Stat_PlanetsScanned, PLANET_NR);
 
         Boolean did = False;
         for (Uns16 planetId = 1; planetId <= PLANET_NR; ++planetId) {
             if (State_HasBuildRequest(pState, planetId)) {
-                if (ProcessBuildRequest(pState, pConfig, planetId) == Success) {
+                Stats_Add(Stat_BuildAttempts, 1);
+                if (ProcessBuildRequest(pState, pConfig, planetId) == Build_Success) {
+                    Stats_Add(Stat_CactusesBuilt, 1);
                     State_SetBuildRequest(pState, planetId, False);
                     did = True;
                 }
@@ -141,33 +155,62 @@ void ProcessBuildRequests(struct State* pState, const struct Config* pConfig)
     }
 
     // Everything that remains is an error.
+    Stats_Add(Stat_PlanetsScanned, PLANET_NR);
     for (Uns16 planetId = 1; planetId <= PLANET_NR; ++planetId) {
         if (State_HasBuildRequest(pState, planetId)) {
+            Stats_Add(Stat_BuildAttempts, 1);
             RaceType_Def owner = State_PlanetOwner(pState, planetId);
-            switch (ProcessBuildRequest(pState, pConfig, planetId)) {
-             case Success:
+            const enum BuildResult result = ProcessBuildRequest(pState, pConfig, planetId);
+            Boolean report = False;
+            if (result != Build_Success) {
+                Events_Add(Event_BuildFailed, owner, planetId, result);
+                report = CommandReport_AddError(pReport, owner, pConfig);
+            }
+            switch (result) {
+             case Build_Success:
                 // Cannot happen
                 break;
-             case Fail_NotOwned:
-                Message_CactusFailed_NotOwned(owner, planetId);
+             case Build_FailNotOwned:
+                Stats_Add(Stat_FailNotOwned, 1);
+                if (report) {
+                    Message_CactusFailed_NotOwned(owner, planetId);
+                }
                 break;
-             case Fail_HasFullCactus:
-                Message_CactusFailed_HasFullCactus(owner, planetId);
+             case Build_FailHasFullCactus:
+                Stats_Add(Stat_FailHasFullCactus, 1);
+                if (report) {
+                    Message_CactusFailed_HasFullCactus(owner, planetId);
+                }
                 break;
-             case Fail_CannotRebuild:
-                Message_CactusFailed_CannotRebuild(owner, planetId);
+             case Build_FailCannotRebuild:
+                Stats_Add(Stat_FailCannotRebuild, 1);
+                if (report) {
+                    Message_CactusFailed_CannotRebuild(owner, planetId);
+                }
                 break;
-             case Fail_NeedBase:
-                Message_CactusFailed_NeedBase(owner, planetId);
+             case Build_FailNeedBase:
+                Stats_Add(Stat_FailNeedBase, 1);
+                if (report) {
+                    Message_CactusFailed_NeedBase(owner, planetId);
+                }
                 break;
-             case Fail_ClansRequired:
-                Message_CactusFailed_ClansRequired(owner, planetId, pConfig->ClansRequired);
+             case Build_FailClansRequired:
+                Stats_Add(Stat_FailClansRequired, 1);
+                if (report) {
+                    Message_CactusFailed_ClansRequired(owner, planetId, pConfig->ClansRequired);
+                }
                 break;
-             case Fail_CactusLimit:
-                Message_CactusFailed_CactusLimit(owner, planetId, pConfig->CactusLimit);
+             case Build_FailCactusLimit:
+                Stats_Add(Stat_FailCactusLimit, 1);
+                if (report) {
+                    Message_CactusFailed_CactusLimit(owner, planetId, pConfig->CactusLimit);
+                }
                 break;
-             case Fail_MinScore:
-                Message_CactusFailed_MinScore(owner, planetId);
+             case Build_FailMinScore:
+                Stats_Add(Stat_FailMinScore, 1);
+                if (report) {
+                    Message_CactusFailed_MinScore(owner, planetId);
+                }
                 break;
             }
         }
@@ -189,16 +232,23 @@ static void ComputeScore(Uns16 planetId, struct State* pState, const struct Conf
         if (State_PlanetHasFullCactus(pState, planetId)) {
             if (currentOwner != NoRace) {
                 // Capturing a cactus
-                Info("\tCactus %d, owned by %d, captured by %d", planetId, previousOwner, currentOwner);
+                LOG_DETAIL("\tCactus %d, owned by %d, captured by %d", planetId, previousOwner, currentOwner);
+                Stats_Add(Stat_Captures, 1);
+                Events_Add(Event_Captured, currentOwner, planetId, previousOwner);
                 State_AddScore(pState, previousOwner, pConfig->LostScore);
                 State_AddScore(pState, currentOwner,  pConfig->CaptureScore);
                 Message_CactusCaptured(previousOwner, currentOwner, planetId, pConfig->LostScore, pConfig->CaptureScore);
             } else {
                 // Destroyed
-                Info("\tCactus %d, owned by %d, lost", planetId, previousOwner);
+                LOG_DETAIL("\tCactus %d, owned by %d, lost", planetId, previousOwner);
+                Stats_Add(Stat_Losses, 1);
+                Events_Add(Event_Lost, previousOwner, planetId, 0);
                 State_AddScore(pState, previousOwner, pConfig->DeadScore);
                 Message_CactusLost(previousOwner, planetId, pConfig->DeadScore);
             }
+            if (pConfig->KeepCactus) {
+                Events_Add(Event_Stump, State_CactusBuilder(pState, planetId), planetId, currentOwner);
+            }
         }
 
         // Destroy or damage cactus
@@ -227,7 +277,8 @@ static void ComputeScore(Uns16 planetId, struct State* pState, const struct Conf
 
 void ComputeScores(struct State* pState, const struct Config* pConfig)
 {
-    Info("    Updating scores...");
+    LOG_PHASE("    Updating scores...");
+    Stats_Add(Stat_PlanetsScanned, PLANET_NR);
     for (Uns16 planetId = 1; planetId <= PLANET_NR; ++planetId) {
         ComputeScore(planetId, pState, pConfig);
     }
@@ -349,7 +400,7 @@ void ProcessVotes(struct State* pState, const struct Config* pConfig, Boolean wr
     size_t numPlayers = 0;
     Int32 totalVotes = 0;
     Int32 yesVotes = 0;
-    Info("    Processing votes...");
+    LOG_PHASE("    Processing votes...");
 
     // Gather players and collect votes
     for (int i = 1; i <= RACE_NR; ++i) {
@@ -371,20 +422,26 @@ void ProcessVotes(struct State* pState, const struct Config* pConfig, Boolean wr
                 } else if (TurnNumber() < pConfig->VoteTurn) {
                     // Ignore
                     Message_VoteIgnored_Turn(r);
-                    Info("\t(-) player %d vote ignored: turn not reached", i);
+                    Events_Add(Event_VoteIgnored, r, 0, VoteIgnored_Turn);
+                    LOG_INFO("\t(-) player %d vote ignored: turn not reached", i);
                 } else if (State_NumCactusesBuiltThisTurn(pState, r) != 0) {
                     // Cancel vote
                     Message_VoteIgnored_Build(r);
-                    Info("\t(-) player %d vote ignored: built a cactus this turn", i);
+                    Events_Add(Event_VoteIgnored, r, 0, VoteIgnored_Build);
+                    LOG_INFO("\t(-) player %d vote ignored: built a cactus this turn", i);
                 } else {
                     // Count vote
-                    Info("\t(-) player %d votes to end with %d votes", i, (int) ourVotes);
+                    LOG_INFO("\t(-) player %d votes to end with %d votes", i, (int) ourVotes);
+                    Events_Add(Event_VoteCast, r, 0, ourVotes);
                     yesVotes += ourVotes;
                 }
             }
         }
     }
 
+    Stats_Add(Stat_TotalVotes, (Uns32) totalVotes);
+    Stats_Add(Stat_YesVotes, (Uns32) yesVotes);
+
     // Degenerate case
     if (numPlayers == 0) {
         return;
@@ -399,7 +456,10 @@ void ProcessVotes(struct State* pState, const struct Config* pConfig, Boolean wr
             || (totalVotes > 0
                 && (100*yesVotes) >= (totalVotes*pConfig->FinishPercent)));
     State_SetFinished(pState, isFinished);
-    Info("\tbest score: %d, votes: %d/%d -> %s", (int) votes[0].Score, (int) yesVotes, (int) totalVotes,
+    if (isFinished) {
+        Events_Add(Event_Finished, votes[0].Player, 0, votes[0].Score);
+    }
+    LOG_INFO("\tbest score: %d, votes: %d/%d -> %s", (int) votes[0].Score, (int) yesVotes, (int) totalVotes,
          isFinished ? "game FINISHED" : "game proceeds");
 
     // Inform players
@@ -415,6 +475,7 @@ void ProcessVotes(struct State* pState, const struct Config* pConfig, Boolean wr
     if (writeRef && pConfig->EnableFinish) {
         FILE* fp = OpenOutputFile("c2ref.txt", GAME_DIR_ONLY);
         SaveRefereeFile(fp, votes, numPlayers, isFinished);
+        Stats_AddFile(fp);
         fclose(fp);
     }
 }
@@ -437,72 +498,318 @@ static void SendScoreReport(const struct State* pState, RaceType_Def player)
     Util_Score(player, numOwnedCactuses, numBuiltCactuses, score, hasVote);
 }
 
-/* Send inventory report to single player.
-   This report can span multiple messages. */
-static void SendInventoryReport(const struct State* pState, RaceType_Def player)
+/* Names of cactus types, indexed by enum CactusType. */
+static const char*const CACTUS_TYPE_NAMES[] = { "cactus", "foreign", "exile", "stump" };
+
+/* Abbreviated names of cactus types for compact layout, indexed by enum CactusType. */
+static const char CACTUS_TYPE_CODES[] = { 'C', 'F', 'E', 'S' };
+
+/* Compact layout: entries per line, width of an entry ("%4d %-9.9s %c%c"), and separator between entries. */
+#define COMPACT_COLUMNS 2
+#define COMPACT_ENTRY_WIDTH 17
+static const char*const COMPACT_SEPARATOR = "  ";
+
+/* Determine type of a cactus as seen by a player.
+   Returns false if the player neither owns nor built it. */
+static Boolean GetCactusType(RaceType_Def player, RaceType_Def owner, RaceType_Def builder, Boolean isFull, enum CactusType* pType)
 {
-    const struct Language*const lang = GetLanguageForPlayer(player);
+    if (builder == NoRace || (owner != player && builder != player)) {
+        return False;
+    }
+    if (isFull) {
+        *pType = Cactus_Full;
+    } else if (builder != player) {
+        *pType = Cactus_Foreign;
+    } else if (owner == player) {
+        *pType = Cactus_Stump;
+    } else {
+        *pType = Cactus_Exile;
+    }
+    return True;
+}
+
+/** Multi-page report.
+    @private */
+struct Report {
     struct Message m;
-    Message_Init(&m);
-    Message_Add(&m, lang->Message_InventoryReport_Header);
-    Boolean hasText = False;
+    RaceType_Def player;
+    const char* continuation;
+    Boolean hasText;
+};
+
+static void Report_Init(struct Report* r, RaceType_Def player, const char* header, const char* continuation)
+{
+    Message_Init(&r->m);
+    Message_Add(&r->m, header);
+    r->player = player;
+    r->continuation = continuation;
+    r->hasText = False;
+}
+
+static void Report_AddLine(struct Report* r, const char* line)
+{
+    Message_Add(&r->m, line);
+    if (r->m.Lines >= MAX_MESSAGE_LINES) {
+        Message_Add(&r->m, GetLanguageForPlayer(r->player)->Continuation);
+        Message_Send(&r->m, r->player);
+        Message_Init(&r->m);
+        Message_Add(&r->m, r->continuation);
+        r->hasText = False;
+    } else {
+        r->hasText = True;
+    }
+}
+
+static void Report_Finish(struct Report* r)
+{
+    if (r->hasText) {
+        Message_Send(&r->m, r->player);
+    }
+}
+
+/** Inventory item: a cactus as seen by a player.
+    @private */
+struct InventoryItem {
+    Uns16 PlanetId;                     ///< Planet Id.
+    Boolean Has;                        ///< True if player currently owns or built this cactus.
+    Boolean Had;                        ///< True if player owned or built this cactus last turn.
+    enum CactusType Type;               ///< Current type, valid if Has is set.
+    enum CactusType OldType;            ///< Previous type, valid if Had is set.
+};
+
+/** Inventory: cactuses for each player, sorted by planet Id.
+    @private */
+struct Inventory {
+    size_t NumItems[RACE_NR];
+    struct InventoryItem Items[RACE_NR][PLANET_NR];
+};
+
+/* Build inventory for all players in a single pass over the planets.
+   Each cactus is recorded for its current and previous owner and builder. */
+static void BuildInventory(struct Inventory* pInv, const struct State* pState)
+{
+    for (int i = 0; i < RACE_NR; ++i) {
+        pInv->NumItems[i] = 0;
+    }
+
+    Stats_Add(Stat_PlanetsScanned, PLANET_NR);
     for (Uns16 planetId = 1; planetId <= PLANET_NR; ++planetId) {
-        if (State_PlanetHasCactus(pState, planetId)
-            && (PlanetOwner(planetId) == player || State_CactusBuilder(pState, planetId) == player))
-        {
-            // Determine type
-            enum CactusType type;
-            const char* what;
-            if (State_PlanetHasFullCactus(pState, planetId)) {
-                what = "cactus";
-                type = Cactus_Full;
-            } else if (State_CactusBuilder(pState, planetId) != player) {
-                what = "foreign";
-                type = Cactus_Foreign;
-            } else if (PlanetOwner(planetId) == player) {
-                what = "stump";
-                type = Cactus_Stump;
-            } else {
-                what = "exile";
-                type = Cactus_Exile;
+        const RaceType_Def builder = State_CactusBuilder(pState, planetId);
+        const RaceType_Def oldBuilder = State_PreviousCactusBuilder(pState, planetId);
+        if (builder == NoRace && oldBuilder == NoRace) {
+            continue;
+        }
+
+        const RaceType_Def owner = PlanetOwner(planetId);
+        const RaceType_Def oldOwner = State_PreviousPlanetOwner(pState, planetId);
+        const Boolean isFull = State_PlanetHasFullCactus(pState, planetId);
+        const Boolean wasFull = State_PlanetHadFullCactus(pState, planetId);
+        const RaceType_Def players[] = { owner, builder, oldOwner, oldBuilder };
+        for (size_t i = 0; i < sizeof(players)/sizeof(players[0]); ++i) {
+            // Record each player only once
+            const RaceType_Def p = players[i];
+            Boolean seen = !(p > 0 && p <= RACE_NR);
+            for (size_t j = 0; j < i && !seen; ++j) {
+                seen = (players[j] == p);
             }
 
-            // Send message
-            char tmp[100];
-            sprintf(tmp, "%4d  %-20s  %s\n", planetId, PlanetName(planetId, 0), what);
-            Message_Add(&m, tmp);
-
-            if (m.Lines >= MAX_MESSAGE_LINES) {
-                Message_Add(&m, lang->Continuation);
-                Message_Send(&m, player);
-                Message_Init(&m);
-                Message_Add(&m, lang->Message_InventoryReport_Continuation);
-                hasText = False;
-            } else {
-                hasText = True;
+            if (!seen) {
+                struct InventoryItem* it = &pInv->Items[p-1][pInv->NumItems[p-1]];
+                it->PlanetId = planetId;
+                it->Has = GetCactusType(p, owner, builder, isFull, &it->Type);
+                it->Had = GetCactusType(p, oldOwner, oldBuilder, wasFull, &it->OldType);
+                if (it->Has || it->Had) {
+                    ++pInv->NumItems[p-1];
+                }
             }
+        }
+    }
+}
+
+/** Inventory report line.
+    @private */
+struct ReportLine {
+    Uns16 PlanetId;                     ///< Planet Id.
+    char Mark;                          ///< Change marker ('+', '-', '*'), or null for full inventory.
+    enum CactusType Type;               ///< Cactus type.
+};
+
+/* Count lines in a message template. */
+static size_t CountLines(const char* str)
+{
+    size_t n = 0;
+    while ((str = strchr(str, '\n')) != 0) {
+        ++n;
+        ++str;
+    }
+    return n;
+}
 
-            // Send utility data record
-            Util_Cactus(player, planetId, type);
+/* Send inventory report, one entry per line. */
+static void SendClassicInventory(RaceType_Def player, const struct ReportLine* lines, size_t numLines, const char* header, const char* continuation)
+{
+    struct Report r;
+    Report_Init(&r, player, header, continuation);
+    for (size_t i = 0; i < numLines; ++i) {
+        const struct ReportLine* p = &lines[i];
+        char tmp[100];
+        if (p->Mark == '\0') {
+            sprintf(tmp, "%4d  %-20s  %s\n", p->PlanetId, PlanetName(p->PlanetId, 0), CACTUS_TYPE_NAMES[p->Type]);
+        } else {
+            sprintf(tmp, "%4d  %-20s  %c %s\n", p->PlanetId, PlanetName(p->PlanetId, 0), p->Mark, CACTUS_TYPE_NAMES[p->Type]);
         }
+        Report_AddLine(&r, tmp);
     }
+    Report_Finish(&r);
+}
 
-    if (hasText) {
+/* Send inventory report, multiple entries per line.
+   Page size is determined in advance from the message size and line limits,
+   so every page is filled completely. Entries run top-to-bottom, then left-to-right. */
+static void SendCompactInventory(RaceType_Def player, const struct ReportLine* lines, size_t numLines, const char* header, const char* continuation)
+{
+    const struct Language*const lang = GetLanguageForPlayer(player);
+    const char*const legend = lang->Message_InventoryReport_Legend;
+
+    // Page geometry
+    const size_t headerLength = MAX(strlen(header) + strlen(legend), strlen(continuation)) + strlen(lang->Continuation);
+    const size_t headerLines  = MAX(CountLines(header) + CountLines(legend), CountLines(continuation)) + CountLines(lang->Continuation);
+    const size_t lineLength   = COMPACT_COLUMNS*COMPACT_ENTRY_WIDTH + (COMPACT_COLUMNS-1)*strlen(COMPACT_SEPARATOR) + 1;
+    size_t rowsPerPage = MIN(headerLength < MAX_MESSAGE_LENGTH ? (MAX_MESSAGE_LENGTH - 1 - headerLength) / lineLength : 0,
+                             headerLines < MAX_MESSAGE_LINES ? MAX_MESSAGE_LINES - headerLines : 0);
+    rowsPerPage = MAX(rowsPerPage, 1);
+    const size_t perPage = rowsPerPage * COMPACT_COLUMNS;
+
+    for (size_t start = 0; start < numLines; start += perPage) {
+        const size_t n = MIN(perPage, numLines - start);
+        const size_t rows = (n + COMPACT_COLUMNS - 1) / COMPACT_COLUMNS;
+
+        struct Message m;
+        Message_Init(&m);
+        if (start == 0) {
+            Message_Add(&m, header);
+            Message_Add(&m, legend);
+        } else {
+            Message_Add(&m, continuation);
+        }
+        for (size_t row = 0; row < rows; ++row) {
+            for (size_t col = 0; col < COMPACT_COLUMNS; ++col) {
+                const size_t index = col*rows + row;
+                if (index < n) {
+                    const struct ReportLine* p = &lines[start + index];
+                    char tmp[50];
+                    sprintf(tmp, "%4d %-9.9s %c%c", p->PlanetId, PlanetName(p->PlanetId, 0),
+                            p->Mark != '\0' ? p->Mark : ' ', CACTUS_TYPE_CODES[p->Type]);
+                    if (col != 0) {
+                        Message_Add(&m, COMPACT_SEPARATOR);
+                    }
+                    Message_Add(&m, tmp);
+                }
+            }
+            Message_Add(&m, "\n");
+        }
+        if (start + n < numLines) {
+            Message_Add(&m, lang->Continuation);
+        }
         Message_Send(&m, player);
     }
 }
 
+/* Send inventory report to single player.
+   If full is set, reports all cactuses, otherwise, only changes since last turn.
+   This report can span multiple messages. */
+static void SendInventoryReport(const struct Inventory* pInv, const struct Config* pConfig, RaceType_Def player, Boolean full)
+{
+    const struct Language*const lang = GetLanguageForPlayer(player);
+    const struct InventoryItem*const items = pInv->Items[player-1];
+    const size_t numItems = pInv->NumItems[player-1];
+    struct CactusListEntry entries[PLANET_NR];
+    size_t numEntries = 0;
+    struct ReportLine lines[PLANET_NR];
+    size_t numLines = 0;
+
+    for (size_t i = 0; i < numItems; ++i) {
+        const struct InventoryItem* it = &items[i];
+        const Uns16 planetId = it->PlanetId;
+
+        // Determine message content: everything, or only changes
+        const Boolean changed = (it->Has != it->Had) || (it->Has && it->Type != it->OldType);
+        if (full ? it->Has : changed) {
+            lines[numLines].PlanetId = planetId;
+            lines[numLines].Mark = (full ? '\0' : !it->Had ? '+' : !it->Has ? '-' : '*');
+            lines[numLines].Type = (it->Has ? it->Type : it->OldType);
+            ++numLines;
+        }
+
+        if (it->Has) {
+            // Remember for utility data
+            entries[numEntries].PlanetId = planetId;
+            entries[numEntries].Type = it->Type;
+            ++numEntries;
+            if (pConfig->LegacyCactusRecords) {
+                Util_Cactus(player, planetId, it->Type);
+            }
+        }
+    }
+
+    // Send messages
+    const char*const header       = full ? lang->Message_InventoryReport_Header       : lang->Message_InventoryChanges_Header;
+    const char*const continuation = full ? lang->Message_InventoryReport_Continuation : lang->Message_InventoryChanges_Continuation;
+    if (pConfig->CompactInventory) {
+        SendCompactInventory(player, lines, numLines, header, continuation);
+    } else {
+        SendClassicInventory(player, lines, numLines, header, continuation);
+    }
+
+    // Send utility data records.
+    // These always contain the full inventory.
+    Util_CactusList(player, entries, numEntries);
+}
+
+/* Determine players who requested a full inventory report ("inv" fcode).
+   Returns a bitfield, bit N set for player N. */
+static Uns32 GetFullInventoryRequests(void)
+{
+    Uns32 result = 0;
+    Stats_Add(Stat_PlanetsScanned, PLANET_NR);
+    for (Uns16 planetId = 1; planetId <= PLANET_NR; ++planetId) {
+        if (IsPlanetExist(planetId)) {
+            RaceType_Def owner = PlanetOwner(planetId);
+            if (owner != 0 && owner <= RACE_NR && (result & (1U << owner)) == 0 && PlanetHasFCode(planetId, "inv")) {
+                result |= 1U << owner;
+                LOG_INFO("\t(+) Player %d: requested inventory", owner);
+            }
+        }
+    }
+    return result;
+}
+
 void SendReports(const struct State* pState, const struct Config* pConfig)
 {
-    (void) pConfig;
+    LOG_PHASE("    Sending reports...");
+
+    // Determine who gets a full inventory
+    Uns32 fullInventory;
+    if (!pConfig->DeltaInventory
+        || (pConfig->FullInventoryTurns > 0 && TurnNumber() % pConfig->FullInventoryTurns == 0))
+    {
+        fullInventory = (Uns32) -1;
+    } else {
+        fullInventory = GetFullInventoryRequests();
+    }
+
+    // Determine everyone's cactuses
+    struct Inventory* pInv = MemAlloc(sizeof(struct Inventory));
+    BuildInventory(pInv, pState);
 
-    Info("    Sending reports...");
     for (int i = 1; i <= RACE_NR; ++i) {
         if (PlayerIsActive(i)) {
             SendScoreReport(pState, i);
-            SendInventoryReport(pState, i);
+            SendInventoryReport(pInv, pConfig, i, (fullInventory & (1U << i)) != 0);
         }
     }
+
+    MemFree(pInv);
 }
 
 void SaveScoreFile(const struct State* pState)
@@ -515,5 +822,6 @@ void SaveScoreFile(const struct State* pState)
             fprintf(fp, "score%d=%d\n", i, (int) State_Score(pState, (RaceType_Def) i));
         }
     }
+    Stats_AddFile(fp);
     fclose(fp);
 }
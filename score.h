@@ -5,15 +5,41 @@
 #ifndef SCORE_H_INCLUDED
 #define SCORE_H_INCLUDED
 
+#include "commands.h"
 #include "config.h"
 #include "state.h"
 
+/** Result of a build request.
+    These values are stored in the event file (cactus.events); do not renumber. */
+enum BuildResult {
+    Build_Success,                      ///< Cactus has been built.
+    Build_FailNotOwned,                 ///< Planet not owned by requester.
+    Build_FailHasFullCactus,            ///< Planet already has a cactus.
+    Build_FailCannotRebuild,            ///< Planet has a stump and RebuildCactus is disabled.
+    Build_FailNeedBase,                 ///< Planet has no starbase and NeedBase is enabled.
+    Build_FailClansRequired,            ///< Planet has not enough clans.
+    Build_FailCactusLimit,              ///< Player has reached CactusLimit.
+    Build_FailMinScore                  ///< Player's score too low.
+};
+
+/** Check whether a planet is eligible for building a cactus.
+    Checks the conditions that depend on the planet only (existing cactus, stump, base, clans),
+    but not ownership or the builder's limits.
+
+    @param [in] pState   State
+    @param [in] pConfig  Configuration
+    @param [in] planetId Planet Id
+    @return true if planet is eligible */
+Boolean IsBuildEligible(const struct State* pState, const struct Config* pConfig, Uns16 planetId);
+
 /** Process build requests.
     Tries to fulfill all requests that have been added using State_SetBuildRequest().
+    Failed builds are counted in pReport and only reported individually up to ErrorMessageLimit.
 
     @param [in,out] pState   State
-    @param [in]     pConfig  Configuration */
-void ProcessBuildRequests(struct State* pState, const struct Config* pConfig);
+    @param [in]     pConfig  Configuration
+    @param [in,out] pReport  Error report, shared with ProcessCommands() */
+void ProcessBuildRequests(struct State* pState, const struct Config* pConfig, struct CommandReport* pReport);
 
 /** Compute scores.
     Checks for planets that changed ownership and updates cactuses accordingly.
@@ -0,0 +1,155 @@
+/**
+  *  \file scoreboard.c
+  *  \brief Agave Tequilana - Farm-wide Scoreboard
+  */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "scoreboard.h"
+#include "log.h"
+#include "stats.h"
+#include "util.h"
+
+static const char SCOREBOARD_MAGIC[8] = { 'C', 'A', 'C', 'T', 'S', 'C', 'B', '1' };
+
+/** Size of file header.
+    @private */
+#define SCOREBOARD_HEADER_SIZE 16
+
+/** Length of game name field.
+    @private */
+#define SCOREBOARD_NAME_SIZE 64
+
+/** Offset of first player in record.
+    @private */
+#define SCOREBOARD_PLAYER_OFFSET 76
+
+/** Number of records read at once when searching.
+    @private */
+#define SCOREBOARD_CHUNK 64
+
+/* Build the record for the current game. */
+static void BuildRecord(char* rec, const struct State* pState)
+{
+    memset(rec, 0, SCOREBOARD_RECORD_SIZE);
+    strncpy(rec, gGameDirectory, SCOREBOARD_NAME_SIZE);
+    PutLong(rec + 64, HashBytes(HASH_INIT, gGameDirectory, strlen(gGameDirectory)));
+    PutWord(rec + 68, TurnNumber());
+    rec[70] = (char) (State_IsFinished(pState) ? 1 : 0);
+
+    const Uns32 totalVotes = Stats_Get(Stat_TotalVotes);
+    rec[71] = (char) (totalVotes > 0 ? 100 * Stats_Get(Stat_YesVotes) / totalVotes : 0);
+    PutLong(rec + 72, (Uns32) time(0));
+
+    // Top players, by insertion into a short sorted list
+    RaceType_Def top[SCOREBOARD_TOP_PLAYERS];
+    int numTop = 0;
+    for (int i = 1; i <= RACE_NR; ++i) {
+        const RaceType_Def r = (RaceType_Def) i;
+        if (PlayerIsActive(r)) {
+            int pos = numTop;
+            while (pos > 0 && State_Score(pState, top[pos-1]) < State_Score(pState, r)) {
+                if (pos < SCOREBOARD_TOP_PLAYERS) {
+                    top[pos] = top[pos-1];
+                }
+                --pos;
+            }
+            if (pos < SCOREBOARD_TOP_PLAYERS) {
+                top[pos] = r;
+                if (numTop < SCOREBOARD_TOP_PLAYERS) {
+                    ++numTop;
+                }
+            }
+        }
+    }
+    for (int i = 0; i < numTop; ++i) {
+        char* p = rec + SCOREBOARD_PLAYER_OFFSET + 8*i;
+        p[0] = (char) top[i];
+        PutWord(p + 2, (Uns16) State_Score(pState, top[i]));
+        PutWord(p + 4, (Uns16) State_NumOwnedCactuses(pState, top[i]));
+    }
+}
+
+/* Check or create the file header. Returns false if the file is not a scoreboard. */
+static Boolean CheckHeader(int fd)
+{
+    char header[SCOREBOARD_HEADER_SIZE];
+    ssize_t n = pread(fd, header, sizeof(header), 0);
+    if (n == 0) {
+        memset(header, 0, sizeof(header));
+        memcpy(header, SCOREBOARD_MAGIC, sizeof(SCOREBOARD_MAGIC));
+        PutLong(header + 8, SCOREBOARD_RECORD_SIZE);
+        return pwrite(fd, header, sizeof(header), 0) == (ssize_t) sizeof(header);
+    }
+    return n == (ssize_t) sizeof(header)
+        && memcmp(header, SCOREBOARD_MAGIC, sizeof(SCOREBOARD_MAGIC)) == 0
+        && (unsigned char) header[8] == SCOREBOARD_RECORD_SIZE
+        && header[9] == 0 && header[10] == 0 && header[11] == 0;
+}
+
+/* Find the record for a game. Returns its file position; if none, the position to append a new one. */
+static off_t FindRecord(int fd, const char* rec)
+{
+    static char buffer[SCOREBOARD_CHUNK * SCOREBOARD_RECORD_SIZE];
+    off_t pos = SCOREBOARD_HEADER_SIZE;
+    ssize_t n;
+    while ((n = pread(fd, buffer, sizeof(buffer), pos)) >= SCOREBOARD_RECORD_SIZE) {
+        const ssize_t numRecords = n / SCOREBOARD_RECORD_SIZE;
+        for (ssize_t i = 0; i < numRecords; ++i) {
+            const char* p = buffer + i*SCOREBOARD_RECORD_SIZE;
+            if (memcmp(p + 64, rec + 64, 4) == 0 && memcmp(p, rec, SCOREBOARD_NAME_SIZE) == 0) {
+                return pos + i*SCOREBOARD_RECORD_SIZE;
+            }
+        }
+        pos += numRecords * SCOREBOARD_RECORD_SIZE;
+    }
+    return pos;
+}
+
+
+/*
+ *  Public Interface
+ */
+
+Boolean Scoreboard_Update(const struct State* pState, const char* fileName)
+{
+    char rec[SCOREBOARD_RECORD_SIZE];
+    BuildRecord(rec, pState);
+
+    int fd = open(fileName, O_RDWR | O_CREAT, 0666);
+    if (fd < 0) {
+        LOG_WARNING("%s: unable to open scoreboard", fileName);
+        return False;
+    }
+
+    // Lock entire file; this serializes concurrent host runs.
+    struct flock lock;
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    Boolean ok = (fcntl(fd, F_SETLKW, &lock) == 0);
+
+    if (ok && !CheckHeader(fd)) {
+        LOG_WARNING("%s: not a scoreboard file", fileName);
+        ok = False;
+    }
+    if (ok) {
+        off_t pos = FindRecord(fd, rec);
+        ok = (pwrite(fd, rec, sizeof(rec), pos) == (ssize_t) sizeof(rec));
+        if (!ok) {
+            LOG_WARNING("%s: unable to update scoreboard", fileName);
+        } else {
+            Stats_Add(Stat_BytesWritten, sizeof(rec));
+        }
+    }
+
+    // Closing the file releases the lock
+    close(fd);
+    return ok;
+}
@@ -0,0 +1,43 @@
+/**
+  *  \file scoreboard.h
+  *  \brief Agave Tequilana - Farm-wide Scoreboard
+  *
+  *  A scoreboard file holds one fixed-size record per game,
+  *  so that a lobby page can show the standings of all games by reading a single file.
+  *  Each host run updates its game's record in place.
+  *
+  *  File layout (all numbers little-endian):
+  *  - 16-byte header: signature "CACTSCB1", long record size (SCOREBOARD_RECORD_SIZE), long reserved
+  *  - records of SCOREBOARD_RECORD_SIZE bytes each:
+  *    - bytes 0-63: game directory name, NUL-padded (truncated if longer)
+  *    - long 64: hash of the full game directory name
+  *    - word 68: turn
+  *    - byte 70: flags (1=game finished)
+  *    - byte 71: percentage of yes votes
+  *    - long 72: time of last update (seconds since 1970)
+  *    - bytes 76-107: top SCOREBOARD_TOP_PLAYERS players, best first, each 8 bytes:
+  *      byte player (0=unused), byte reserved, word score (signed), word cactuses owned, word reserved
+  *    - bytes 108-127: reserved
+  *
+  *  Writers lock the file (fcntl) while updating; a record is written with a single write.
+  */
+#ifndef SCOREBOARD_H_INCLUDED
+#define SCOREBOARD_H_INCLUDED
+
+#include "state.h"
+
+/** Size of a scoreboard record. */
+#define SCOREBOARD_RECORD_SIZE 128
+
+/** Number of players listed per game. */
+#define SCOREBOARD_TOP_PLAYERS 4
+
+/** Update scoreboard.
+    Creates or updates the record for the current game (gGameDirectory).
+    Call after ProcessVotes().
+    @param [in] pState    State
+    @param [in] fileName  Name of scoreboard file; created if it does not exist
+    @return true on success */
+Boolean Scoreboard_Update(const struct State* pState, const char* fileName);
+
+#endif
@@ -6,7 +6,9 @@
 #include "sendconf.h"
 #include "config.h"
 #include "language.h"
+#include "log.h"
 #include "message.h"
+#include "stats.h"
 #include "util.h"
 
 /** @private */
@@ -39,23 +41,24 @@ static void SendConfig(const struct Config* c, RaceType_Def player)
     st.player = player;
     Message_Init(&st.m);
     Message_Add(&st.m, lang->SendConfig_Header);
-    Config_Format(c, State_SendOption, &st);
+    Config_Format(c, False, State_SendOption, &st);
     Message_Send(&st.m, st.player);
 }
 
 
 void DoSendConfig(const struct Config* c)
 {
-    Info("    Sending configuration...");
+    LOG_PHASE("    Sending configuration...");
 
     Uns32 gotConfig = 0;
+    Stats_Add(Stat_PlanetsScanned, PLANET_NR);
     for (Uns16 planetId = 1; planetId <= PLANET_NR; ++planetId) {
         if (IsPlanetExist(planetId)) {
             RaceType_Def owner = PlanetOwner(planetId);
             if ((owner != 0) && (owner <= RACE_NR) && (gotConfig & (1U << owner)) == 0) {
                 if (PlanetHasFCode(planetId, "con")) {
                     gotConfig |= 1U << owner;
-                    Info("\t(+) Player %d: requested configuration", owner);
+                    LOG_INFO("\t(+) Player %d: requested configuration", owner);
                     SendConfig(c, owner);
                 }
             }
@@ -3,7 +3,9 @@
   *  \brief Agave Tequilana - Status
   */
 
+#include "log.h"
 #include "state.h"
+#include "stats.h"
 #include "util.h"
 
 static const char*const STATE_FILE_NAME = "cactus.hst";
@@ -73,6 +75,18 @@ struct State {
     /** Previous cactus counts, for difference reporting. */
     struct RaceArray OldNumOwnedCactuses;
 
+    /** Previous HasFullCactus, for difference reporting. */
+    struct PlanetArray OldHasFullCactus;
+
+    /** Previous LastPlanetOwner, for difference reporting. */
+    struct PlanetArray OldLastPlanetOwner;
+
+    /** Previous CactusBuilder, for difference reporting. */
+    struct PlanetArray OldCactusBuilder;
+
+    /** Turn number stored in the state file; 0 if none. */
+    Uns16 PreviousTurn;
+
     /** Overall "is-finished" state. */
     Boolean IsFinished;
 };
@@ -214,8 +228,12 @@ void State_Load(struct State* pState, Boolean initOwners)
         if (ok) {
             pState->OldScore = pState->Score;
             pState->OldNumOwnedCactuses = pState->NumOwnedCactuses;
+            pState->OldHasFullCactus = pState->HasFullCactus;
+            pState->OldLastPlanetOwner = pState->LastPlanetOwner;
+            pState->OldCactusBuilder = pState->CactusBuilder;
+            pState->PreviousTurn = turn;
         } else {
-            Error("Unable to read state file; discarding state");
+            LOG_ERROR("Unable to read state file; discarding state");
             State_Reset(pState, initOwners);
         }
     }
@@ -237,6 +255,10 @@ void State_Reset(struct State* pState, Boolean initOwners)
     RaceArray_Clear(&pState->NumCactusesBuiltThisTurn);
     RaceArray_Clear(&pState->OldScore);
     RaceArray_Clear(&pState->OldNumOwnedCactuses);
+    PlanetArray_Clear(&pState->OldHasFullCactus);
+    PlanetArray_Clear(&pState->OldLastPlanetOwner);
+    PlanetArray_Clear(&pState->OldCactusBuilder);
+    pState->PreviousTurn = 0;
     pState->IsFinished = False;
 
     // Initialize LastPlanetOwner.
@@ -265,10 +287,11 @@ void State_Save(const struct State* pState)
             && DOSWrite16(&turn, 1, fp)
             && PlanetArray_Save(&pState->CactusBuilder, fp)
             && RaceArray_Save(&pState->NumBuiltCactuses, fp);
+        Stats_AddFile(fp);
         fclose(fp);
     }
     if (!ok) {
-        Error("Unable to write state file; state has been lost");
+        LOG_ERROR("Unable to write state file; state has been lost");
     }
 }
 
@@ -300,6 +323,129 @@ void State_Dump(const struct State* pState, FILE* fp)
     }
 }
 
+/*
+ *  Export
+ */
+
+/** Buffered writer for State_Export.
+    Formats directly into a buffer, to keep the overhead for big exports low.
+    @private */
+struct Writer {
+    FILE* File;                         ///< Output file.
+    size_t Length;                      ///< Number of bytes in Buffer.
+    char Buffer[8192];                  ///< Buffered data.
+};
+
+static void Writer_Flush(struct Writer* w)
+{
+    fwrite(w->Buffer, 1, w->Length, w->File);
+    w->Length = 0;
+}
+
+static void Writer_Put(struct Writer* w, const char* s)
+{
+    while (*s != '\0') {
+        if (w->Length == sizeof(w->Buffer)) {
+            Writer_Flush(w);
+        }
+        w->Buffer[w->Length++] = *s++;
+    }
+}
+
+static void Writer_PutInt(struct Writer* w, int value)
+{
+    char tmp[12];
+    char* p = tmp + sizeof(tmp);
+    unsigned int u = (value < 0 ? 0U - (unsigned int) value : (unsigned int) value);
+    *--p = '\0';
+    do {
+        *--p = (char) ('0' + u % 10);
+        u /= 10;
+    } while (u != 0);
+    if (value < 0) {
+        *--p = '-';
+    }
+    Writer_Put(w, p);
+}
+
+static void ExportJSON(const struct State* pState, struct Writer* w)
+{
+    Writer_Put(w, "{\"turn\":");
+    Writer_PutInt(w, pState->PreviousTurn);
+    Writer_Put(w, ",\"players\":[");
+    for (int i = 1; i <= RACE_NR; ++i) {
+        Writer_Put(w, i == 1 ? "\n{\"player\":" : ",\n{\"player\":");
+        Writer_PutInt(w, i);
+        Writer_Put(w, ",\"score\":");
+        Writer_PutInt(w, RaceArray_Get(&pState->Score, i));
+        Writer_Put(w, ",\"built\":");
+        Writer_PutInt(w, RaceArray_Get(&pState->NumBuiltCactuses, i));
+        Writer_Put(w, ",\"owned\":");
+        Writer_PutInt(w, RaceArray_Get(&pState->NumOwnedCactuses, i));
+        Writer_Put(w, RaceArray_Get(&pState->VoteStatus, i) ? ",\"vote\":true}" : ",\"vote\":false}");
+    }
+    Writer_Put(w, "],\n\"planets\":[");
+    for (Uns16 i = 1; i <= PLANET_NR; ++i) {
+        Writer_Put(w, i == 1 ? "\n{\"planet\":" : ",\n{\"planet\":");
+        Writer_PutInt(w, i);
+        Writer_Put(w, ",\"owner\":");
+        Writer_PutInt(w, PlanetArray_Get(&pState->LastPlanetOwner, i));
+        Writer_Put(w, ",\"builder\":");
+        Writer_PutInt(w, PlanetArray_Get(&pState->CactusBuilder, i));
+        Writer_Put(w, ",\"type\":\"");
+        Writer_Put(w, State_CactusTypeName(pState, i));
+        Writer_Put(w, "\"}");
+    }
+    Writer_Put(w, "]}\n");
+}
+
+static void ExportCSV(const struct State* pState, struct Writer* w)
+{
+    Writer_Put(w, "kind,id,turn,score,built,owned,vote,owner,builder,type\n");
+    for (int i = 1; i <= RACE_NR; ++i) {
+        Writer_Put(w, "player,");
+        Writer_PutInt(w, i);
+        Writer_Put(w, ",");
+        Writer_PutInt(w, pState->PreviousTurn);
+        Writer_Put(w, ",");
+        Writer_PutInt(w, RaceArray_Get(&pState->Score, i));
+        Writer_Put(w, ",");
+        Writer_PutInt(w, RaceArray_Get(&pState->NumBuiltCactuses, i));
+        Writer_Put(w, ",");
+        Writer_PutInt(w, RaceArray_Get(&pState->NumOwnedCactuses, i));
+        Writer_Put(w, RaceArray_Get(&pState->VoteStatus, i) ? ",1,,,\n" : ",0,,,\n");
+    }
+    for (Uns16 i = 1; i <= PLANET_NR; ++i) {
+        Writer_Put(w, "planet,");
+        Writer_PutInt(w, i);
+        Writer_Put(w, ",");
+        Writer_PutInt(w, pState->PreviousTurn);
+        Writer_Put(w, ",,,,,");
+        Writer_PutInt(w, PlanetArray_Get(&pState->LastPlanetOwner, i));
+        Writer_Put(w, ",");
+        Writer_PutInt(w, PlanetArray_Get(&pState->CactusBuilder, i));
+        Writer_Put(w, ",");
+        Writer_Put(w, State_CactusTypeName(pState, i));
+        Writer_Put(w, "\n");
+    }
+}
+
+void State_Export(const struct State* pState, enum StateFormat format, FILE* fp)
+{
+    struct Writer w;
+    w.File = fp;
+    w.Length = 0;
+    switch (format) {
+     case StateFormat_JSON:
+        ExportJSON(pState, &w);
+        break;
+     case StateFormat_CSV:
+        ExportCSV(pState, &w);
+        break;
+    }
+    Writer_Flush(&w);
+}
+
 void State_UpdateCounts(struct State* pState)
 {
     RaceArray_Clear(&pState->NumOwnedCactuses);
@@ -332,6 +478,13 @@ RaceType_Def State_CactusBuilder(const struct State* pState, Uns16 planetId)
     return PlanetArray_Get(&pState->CactusBuilder, planetId);
 }
 
+const char* State_CactusTypeName(const struct State* pState, Uns16 planetId)
+{
+    return State_PlanetHasFullCactus(pState, planetId) ? "cactus"
+        : State_PlanetHasCactus(pState, planetId) ? "stump"
+        : "none";
+}
+
 void State_RemoveCactus(struct State* pState, Uns16 planetId, Boolean keepStump)
 {
     RaceType_Def builder = PlanetArray_Get(&pState->CactusBuilder, planetId);
@@ -377,6 +530,31 @@ int State_NumOwnedCactusesChange(const struct State* pState, RaceType_Def owner)
         - RaceArray_Get(&pState->OldNumOwnedCactuses, owner);
 }
 
+/*
+ *  Previous Turn
+ */
+
+Boolean State_PlanetHadFullCactus(const struct State* pState, Uns16 planetId)
+{
+    return PlanetArray_Get(&pState->OldCactusBuilder, planetId) != 0
+        && PlanetArray_Get(&pState->OldHasFullCactus, planetId) != 0;
+}
+
+RaceType_Def State_PreviousCactusBuilder(const struct State* pState, Uns16 planetId)
+{
+    return PlanetArray_Get(&pState->OldCactusBuilder, planetId);
+}
+
+RaceType_Def State_PreviousPlanetOwner(const struct State* pState, Uns16 planetId)
+{
+    return PlanetArray_Get(&pState->OldLastPlanetOwner, planetId);
+}
+
+Uns16 State_PreviousTurn(const struct State* pState)
+{
+    return pState->PreviousTurn;
+}
+
 /*
  *  Planet Ownership
  */
@@ -453,7 +631,7 @@ void State_SetFinished(struct State* pState, Boolean flag)
 void State_AddScore(struct State* pState, RaceType_Def race, int delta)
 {
     RaceArray_Add(&pState->Score, race, delta);
-    Info("\t    player %d, score %d => %d", (int)race, (int)delta, RaceArray_Get(&pState->Score, race));
+    LOG_DETAIL("\t    player %d, score %d => %d", (int)race, (int)delta, RaceArray_Get(&pState->Score, race));
 }
 
 Int16 State_Score(const struct State* pState, RaceType_Def race)
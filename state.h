@@ -41,6 +41,19 @@ void State_Save(const struct State* pState);
     @param [out] fp    Output file */
 void State_Dump(const struct State* pState, FILE* fp);
 
+/** Format for State_Export(). */
+enum StateFormat {
+    StateFormat_JSON,                   ///< A single JSON object with "players" and "planets" arrays.
+    StateFormat_CSV                     ///< CSV with one row per player and one per planet.
+};
+
+/** Export state in machine-readable form.
+    Exports per-player score, built and owned cactuses and vote, and per-planet owner, builder and cactus type.
+    @param [in]  pState State
+    @param [in]  format Format
+    @param [out] fp     Output file */
+void State_Export(const struct State* pState, enum StateFormat format, FILE* fp);
+
 /** Regenerate plant counts.
     The NumBuiltCactuses and NumOwnedCactuses fields can always be regenerated.
     This will fix a corrupted state.
@@ -70,6 +83,12 @@ Boolean State_PlanetHasFullCactus(const struct State* pState, Uns16 planetId);
     @return builder */
 RaceType_Def State_CactusBuilder(const struct State* pState, Uns16 planetId);
 
+/** Get name of cactus type on a planet, for machine-readable output.
+    @param [in] pState   State
+    @param [in] planetId Planet Id
+    @return "cactus", "stump", or "none" */
+const char* State_CactusTypeName(const struct State* pState, Uns16 planetId);
+
 /** Remove a cactus.
     Call is ignored if there is no cactus.
     @param [out] pState    State
@@ -112,6 +131,38 @@ int State_NumCactusesBuiltThisTurn(const struct State* pState, RaceType_Def owne
 int State_NumOwnedCactusesChange(const struct State* pState, RaceType_Def owner);
 
 
+/*
+ *  Previous Turn
+ *
+ *  Cactus status as loaded from the state file, i.e. as reported to players last turn.
+ *  This is transient state; it is not modified by the other functions.
+ */
+
+/** Check whether planet had a full cactus last turn.
+    @param [in]  pState    State
+    @param [in]  planetId  Planet to check
+    @return true if planet had a cactus (not just a stump). */
+Boolean State_PlanetHadFullCactus(const struct State* pState, Uns16 planetId);
+
+/** Get builder of a cactus last turn.
+    @param [in]  pState    State
+    @param [in]  planetId  Planet to check
+    @return builder; NoRace if planet had no cactus or stump */
+RaceType_Def State_PreviousCactusBuilder(const struct State* pState, Uns16 planetId);
+
+/** Get planet owner last turn.
+    @param [in]  pState    State
+    @param [in]  planetId  Planet to check
+    @return owner */
+RaceType_Def State_PreviousPlanetOwner(const struct State* pState, Uns16 planetId);
+
+/** Get turn number of the state file.
+    This identifies the turn players are currently playing.
+    @param [in]  pState    State
+    @return turn number; 0 if no state file was loaded */
+Uns16 State_PreviousTurn(const struct State* pState);
+
+
 /*
  *  Planet Ownership
  */
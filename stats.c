@@ -0,0 +1,171 @@
+/**
+  *  \file stats.c
+  *  \brief Agave Tequilana - Run Statistics
+  */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "log.h"
+#include "stats.h"
+#include "version.h"
+
+
+/** Maximum number of phases per run.
+    @private */
+#define MAX_PHASES 20
+
+/** Names of counters, in file.
+    @private */
+static const char*const STAT_NAMES[NUM_STATS] = {
+    "planets_scanned",
+    "commands",
+    "build_rounds",
+    "build_attempts",
+    "cactuses_built",
+    "fail_not_owned",
+    "fail_has_full_cactus",
+    "fail_cannot_rebuild",
+    "fail_need_base",
+    "fail_clans_required",
+    "fail_cactus_limit",
+    "fail_min_score",
+    "captures",
+    "losses",
+    "total_votes",
+    "yes_votes",
+    "messages",
+    "util_records",
+    "bytes_written",
+};
+
+/** A measured phase.
+    @private */
+struct Phase {
+    const char* Name;
+    double Seconds;
+};
+
+static Uns32 gCounters[NUM_STATS];
+static struct Phase gPhases[MAX_PHASES];
+static size_t gNumPhases;
+static size_t gCurrentPhase;
+static double gPhaseStart;
+static double gRunStart;
+static Boolean gRunning;
+
+/* Get monotonic time in seconds. */
+static double GetTime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + ts.tv_nsec / 1.0e9;
+}
+
+/* End current phase, if any. */
+static void EndPhase(double now)
+{
+    if (gRunning && gCurrentPhase < gNumPhases) {
+        gPhases[gCurrentPhase].Seconds += now - gPhaseStart;
+    }
+}
+
+
+/*
+ *  Public Interface
+ */
+
+void Stats_Phase(const char* name)
+{
+    Log_Flush();
+
+    const double now = GetTime();
+    if (!gRunning) {
+        gRunStart = now;
+        gRunning = True;
+    } else {
+        EndPhase(now);
+    }
+
+    // A phase that is resumed continues its existing entry
+    for (size_t i = 0; i < gNumPhases; ++i) {
+        if (strcmp(gPhases[i].Name, name) == 0) {
+            gCurrentPhase = i;
+            gPhaseStart = now;
+            return;
+        }
+    }
+    if (gNumPhases < MAX_PHASES) {
+        gCurrentPhase = gNumPhases;
+        gPhases[gNumPhases].Name = name;
+        gPhases[gNumPhases].Seconds = 0;
+        ++gNumPhases;
+    } else {
+        gCurrentPhase = MAX_PHASES;
+    }
+    gPhaseStart = now;
+}
+
+void Stats_Add(enum Stat which, Uns32 value)
+{
+    gCounters[which] += value;
+}
+
+void Stats_AddFile(FILE* fp)
+{
+    long pos = ftell(fp);
+    if (pos > 0) {
+        gCounters[Stat_BytesWritten] += (Uns32) pos;
+    }
+}
+
+Uns32 Stats_Get(enum Stat which)
+{
+    return gCounters[which];
+}
+
+const char* Stats_GetName(enum Stat which)
+{
+    return STAT_NAMES[which];
+}
+
+size_t Stats_NumPhases(void)
+{
+    return gNumPhases;
+}
+
+const char* Stats_PhaseName(size_t index)
+{
+    return gPhases[index].Name;
+}
+
+double Stats_PhaseTime(size_t index)
+{
+    return gPhases[index].Seconds;
+}
+
+void Stats_Save(const char* fileName)
+{
+    const double now = GetTime();
+    EndPhase(now);
+    gPhaseStart = now;
+
+    FILE* fp = OpenOutputFile(fileName, GAME_DIR_ONLY | TEXT_MODE | NO_MISSING_ERROR);
+    if (fp == 0) {
+        LOG_WARNING("Unable to write %s", fileName);
+        return;
+    }
+
+    fprintf(fp, "version %s\n", VERSION);
+    fprintf(fp, "turn %d\n", (int) TurnNumber());
+    for (size_t i = 0; i < gNumPhases; ++i) {
+        fprintf(fp, "time.%s %.6f\n", gPhases[i].Name, gPhases[i].Seconds);
+    }
+    fprintf(fp, "time.total %.6f\n", gRunning ? now - gRunStart : 0.0);
+    for (size_t i = 0; i < NUM_STATS; ++i) {
+        fprintf(fp, "count.%s %lu\n", STAT_NAMES[i], (unsigned long) gCounters[i]);
+    }
+    fclose(fp);
+}
@@ -0,0 +1,85 @@
+/**
+  *  \file stats.h
+  *  \brief Agave Tequilana - Run Statistics
+  */
+#ifndef STATS_H_INCLUDED
+#define STATS_H_INCLUDED
+
+#include <stdio.h>
+#include <phostpdk.h>
+
+/** Statistics counter. */
+enum Stat {
+    Stat_PlanetsScanned,                ///< Planets looked at in full-universe scans.
+    Stat_Commands,                      ///< Commands applied.
+    Stat_BuildRounds,                   ///< Rounds of ProcessBuildRequests().
+    Stat_BuildAttempts,                 ///< Calls to build a single cactus.
+    Stat_CactusesBuilt,                 ///< Cactuses built.
+    Stat_FailNotOwned,                  ///< Builds failed: planet not owned.
+    Stat_FailHasFullCactus,             ///< Builds failed: planet already has a cactus.
+    Stat_FailCannotRebuild,             ///< Builds failed: planet has a stump.
+    Stat_FailNeedBase,                  ///< Builds failed: no starbase.
+    Stat_FailClansRequired,             ///< Builds failed: not enough clans.
+    Stat_FailCactusLimit,               ///< Builds failed: CactusLimit reached.
+    Stat_FailMinScore,                  ///< Builds failed: score too low.
+    Stat_Captures,                      ///< Cactuses captured.
+    Stat_Losses,                        ///< Cactuses lost (planet left unowned).
+    Stat_TotalVotes,                    ///< Total votes.
+    Stat_YesVotes,                      ///< Votes to end the game.
+    Stat_Messages,                      ///< Messages sent.
+    Stat_UtilRecords,                   ///< util.dat records written.
+    Stat_BytesWritten                   ///< Bytes of messages, util.dat records, and files written.
+};
+
+/** Number of statistics counters. */
+#define NUM_STATS (Stat_BytesWritten + 1)
+
+/** Start a new phase.
+    Ends the current phase, if any, and starts measuring time for the new one.
+    Starting a phase that has been seen before adds to its time.
+    Buffered log messages are flushed.
+    @param [in] name  Name of phase; must be a string literal (pointer is kept) */
+void Stats_Phase(const char* name);
+
+/** Add to a counter.
+    @param [in] which  Counter
+    @param [in] value  Value to add */
+void Stats_Add(enum Stat which, Uns32 value);
+
+/** Count a file written.
+    Adds the file's size to Stat_BytesWritten; call immediately before closing it.
+    @param [in] fp  File, opened for writing */
+void Stats_AddFile(FILE* fp);
+
+/** Get a counter.
+    @param [in] which  Counter
+    @return current value */
+Uns32 Stats_Get(enum Stat which);
+
+/** Get name of a counter.
+    @param [in] which  Counter
+    @return name, lower-case with underscores */
+const char* Stats_GetName(enum Stat which);
+
+/** Get number of phases seen so far.
+    @return number of phases */
+size_t Stats_NumPhases(void);
+
+/** Get phase name.
+    @param [in] index  Index, [0,Stats_NumPhases())
+    @return name as given to Stats_Phase() */
+const char* Stats_PhaseName(size_t index);
+
+/** Get time spent in a phase.
+    @param [in] index  Index, [0,Stats_NumPhases())
+    @return time in seconds; does not include the currently running part of the current phase */
+double Stats_PhaseTime(size_t index);
+
+/** Save statistics.
+    Ends the current phase and writes all phase times and counters to a file
+    in the game directory, one `name value` pair per line.
+    @param [in] fileName  File name (`cactus.stats`, or `cactus1.stats` for the AUXHOST1 stage)
+    @pre PDK initialized (gGameDirectory set) */
+void Stats_Save(const char* fileName);
+
+#endif
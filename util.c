@@ -31,3 +31,63 @@ const char* StrStartsWith(const char* line, const char* expectedPrefix)
     }
     return line;
 }
+
+char* ReadWholeFile(const char* name, Uns16 flags, size_t* pSize)
+{
+    FILE* fp = OpenInputFile(name, flags | NO_MISSING_ERROR);
+    if (fp == 0) {
+        return 0;
+    }
+
+    char* result = 0;
+    long size;
+    if (fseek(fp, 0, SEEK_END) == 0 && (size = ftell(fp)) >= 0 && fseek(fp, 0, SEEK_SET) == 0) {
+        result = MemAlloc((size_t) size + 1);
+        if (fread(result, 1, (size_t) size, fp) == (size_t) size) {
+            *pSize = (size_t) size;
+        } else {
+            MemFree(result);
+            result = 0;
+        }
+    }
+    fclose(fp);
+    return result;
+}
+
+void PutLong(char* p, Uns32 value)
+{
+    PutWord(p, (Uns16) (value & 0xFFFF));
+    PutWord(p + 2, (Uns16) (value >> 16));
+}
+
+void PutWord(char* p, Uns16 value)
+{
+    p[0] = (char) (value & 255);
+    p[1] = (char) (value >> 8);
+}
+
+Uns32 GetLong(const char* p)
+{
+    return GetWord(p) | ((Uns32) GetWord(p + 2) << 16);
+}
+
+Uns16 GetWord(const char* p)
+{
+    return (Uns16) ((unsigned char) p[0] | ((unsigned char) p[1] << 8));
+}
+
+Uns32 HashBytes(Uns32 h, const char* p, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) {
+        h = (h ^ (unsigned char) p[i]) * 16777619U;
+    }
+    return h;
+}
+
+Uns32 HashBytesNoCase(Uns32 h, const char* p, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) {
+        h = (h ^ (unsigned char) tolower((unsigned char) p[i])) * 16777619U;
+    }
+    return h;
+}
@@ -25,6 +25,59 @@ Boolean PlanetHasFCode(Uns16 planetId, const char* expected);
     @return Suffix on success, otherwise null */
 const char* StrStartsWith(const char* line, const char* expectedPrefix);
 
+/** Read a file into memory.
+    @param [in]  name   File name, see OpenInputFile()
+    @param [in]  flags  Flags, see OpenInputFile(); NO_MISSING_ERROR is implied
+    @param [out] pSize  File size
+    @return newly-allocated file content (free with MemFree()); null if file does not exist or cannot be read */
+char* ReadWholeFile(const char* name, Uns16 flags, size_t* pSize);
+
+/*
+ *  Binary Data
+ *
+ *  Our own files use little-endian byte order, like the game's files.
+ *  These functions work on byte buffers and therefore need no alignment.
+ */
+
+/** Store 32-bit value, little-endian.
+    @param [out] p      Buffer (4 bytes)
+    @param [in]  value  Value */
+void PutLong(char* p, Uns32 value);
+
+/** Store 16-bit value, little-endian.
+    @param [out] p      Buffer (2 bytes)
+    @param [in]  value  Value */
+void PutWord(char* p, Uns16 value);
+
+/** Load 32-bit value, little-endian.
+    @param [in] p  Buffer (4 bytes)
+    @return value */
+Uns32 GetLong(const char* p);
+
+/** Load 16-bit value, little-endian.
+    @param [in] p  Buffer (2 bytes)
+    @return value */
+Uns16 GetWord(const char* p);
+
+/** Initial value for HashBytes() (FNV-1a offset basis). */
+#define HASH_INIT 2166136261U
+
+/** Hash bytes (FNV-1a).
+    Hash values are stored in files; do not change the algorithm.
+    @param [in] h     Hash so far; HASH_INIT to start
+    @param [in] p     Data
+    @param [in] n     Number of bytes
+    @return updated hash */
+Uns32 HashBytes(Uns32 h, const char* p, size_t n);
+
+/** Hash bytes (FNV-1a), ignoring case.
+    Same as HashBytes(), but hashes every byte in lower case.
+    @param [in] h     Hash so far; HASH_INIT to start
+    @param [in] p     Data
+    @param [in] n     Number of bytes
+    @return updated hash */
+Uns32 HashBytesNoCase(Uns32 h, const char* p, size_t n);
+
 /** Get minimum of two values.
     @param a First value
     @param b Second value
@@ -5,6 +5,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include "stats.h"
 #include "utildata.h"
 #include "version.h"
 
@@ -18,6 +19,20 @@ static const Uns16 RECORD_PLAYER_SCORE = 51;
 /* Agave Tequilana custom records */
 static const Uns16 RECORD_SCORE = 0x40A0;
 static const Uns16 RECORD_CACTUS = 0x40A1;
+static const Uns16 RECORD_CACTUS_LIST = 0x40A2;
+
+/* Maximum number of entries in a RECORD_CACTUS_LIST record */
+#define CACTUS_LIST_CHUNK 250
+
+/* Bit position of type in a RECORD_CACTUS_LIST entry */
+#define CACTUS_LIST_TYPE_SHIFT 14
+
+/* Count a record written */
+static void CountRecord(size_t size)
+{
+    Stats_Add(Stat_UtilRecords, 1);
+    Stats_Add(Stat_BytesWritten, (Uns32) size);
+}
 
 void Util_PlayerScore(RaceType_Def to, const char* name, Uns16 scoreId, Int16 winLimit, Uns32 (*score)[RACE_NR])
 {
@@ -40,6 +55,7 @@ void Util_PlayerScore(RaceType_Def to, const char* name, Uns16 scoreId, Int16 wi
     void* pointers[] = { &tag, &words, &longs };
     Uns16 sizes[] = { sizeof(tag), sizeof(words), sizeof(longs) };
     PutUtilRecord(to, RECORD_PLAYER_SCORE, DIM(pointers), sizes, pointers);
+    CountRecord(sizeof(tag) + sizeof(words) + sizeof(longs));
 }
 
 void Util_Score(RaceType_Def to, int numOwnedCactuses, int numBuiltCactuses, int score, Boolean vote)
@@ -59,6 +75,7 @@ void Util_Score(RaceType_Def to, int numOwnedCactuses, int numBuiltCactuses, int
     void* pointers[] = { &tag, &data };
     Uns16 sizes[] = { sizeof(tag), sizeof(data) };
     PutUtilRecord(to, RECORD_SCORE, DIM(pointers), sizes, pointers);
+    CountRecord(sizeof(tag) + sizeof(data));
 }
 
 
@@ -71,4 +88,23 @@ void Util_Cactus(RaceType_Def to, Uns16 planetId, enum CactusType type)
 
     WordSwapShort(data, DIM(data));
     PutUtilRecordSimple(to, RECORD_CACTUS, sizeof(data), &data);
+    CountRecord(sizeof(data));
+}
+
+void Util_CactusList(RaceType_Def to, const struct CactusListEntry* entries, size_t numEntries)
+{
+    while (numEntries > 0) {
+        Uns16 data[CACTUS_LIST_CHUNK];
+        size_t n = numEntries < CACTUS_LIST_CHUNK ? numEntries : CACTUS_LIST_CHUNK;
+        for (size_t i = 0; i < n; ++i) {
+            data[i] = (Uns16) (entries[i].PlanetId | ((Uns16) entries[i].Type << CACTUS_LIST_TYPE_SHIFT));
+        }
+
+        WordSwapShort(data, (Uns16) n);
+        PutUtilRecordSimple(to, RECORD_CACTUS_LIST, (Uns16) (n * sizeof(data[0])), &data);
+        CountRecord(n * sizeof(data[0]));
+
+        entries += n;
+        numEntries -= n;
+    }
 }
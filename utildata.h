@@ -25,6 +25,12 @@ enum CactusType {
     Cactus_Stump = 3
 };
 
+/** Entry for Util_CactusList(). */
+struct CactusListEntry {
+    Uns16 PlanetId;                     ///< Planet Id.
+    enum CactusType Type;               ///< Cactus type.
+};
+
 
 /** Write a "Player Score" record.
     Each of these records reports one score summary for all players.
@@ -54,4 +60,13 @@ void Util_Score(RaceType_Def to, int numOwnedCactuses, int numBuiltCactuses, int
     @param type              Cactus type */
 void Util_Cactus(RaceType_Def to, Uns16 planetId, enum CactusType type);
 
+/** Write "Cactus List" custom records.
+    These records report all cactuses a player built or owns, in packed form.
+    Large lists are split into multiple records; an empty list produces no record.
+
+    @param to                Receiver
+    @param entries           Cactuses
+    @param numEntries        Number of elements in entries */
+void Util_CactusList(RaceType_Def to, const struct CactusListEntry* entries, size_t numEntries);
+
 #endif